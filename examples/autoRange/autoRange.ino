@@ -0,0 +1,67 @@
+/**
+ **************************************************
+ *
+ * @file        autoRange.ino
+ * @brief       Let the library pick the ADC and amplifier gain which fit the gas concentration
+ *
+ *              The gains in sensorConfigData.h cover the whole range of the cell, so small
+ *              concentrations only use a few ADC codes. With auto-ranging the gains follow
+ *              the signal: small concentrations are measured with a finer resolution and
+ *              spikes still don't clip.
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     Robert @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // Range the ADC gain and, when that's not enough, the gain of the LMP91000
+    // Use AUTORANGE_PGA to leave the LMP91000 alone
+    sensor.setAutoRange(AUTORANGE_PGA_TIA);
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Make a reading, the gains may change after it for the next one
+    double reading = sensor.getPPM();
+
+    // Print the reading with 4 digits of precision and the gains it was made with
+    Serial.print("Reading: ");
+    Serial.print(reading, 4);
+    Serial.print(" PPM, ADC gain code: ");
+    Serial.print(sensor.getAdsGain());
+    Serial.print(", TIA gain code: ");
+    Serial.println(sensor.getTiaGainCode());
+
+    // Wait a bit before reading again
+    delay(1000);
+}
@@ -26,9 +26,12 @@
 // JP5 for 0x49
 // JP6 for 0x4A
 // JP7 for 0x4B
-// The final parameter is the GPIO pin for LMPEN
+// The third parameter is the GPIO pin for LMPEN
 ElectrochemicalGasSensor sensor(SENSOR_SO2, 0x4B, 5);
 
+// If your board has more than one I2C bus, you can also choose which one the breakout is on:
+// ElectrochemicalGasSensor sensor(SENSOR_SO2, 0x4B, 5, &Wire1);
+
 void setup()
 {
     Serial.begin(115200); // For debugging
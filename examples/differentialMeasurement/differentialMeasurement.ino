@@ -0,0 +1,68 @@
+/**
+ **************************************************
+ *
+ * @file        differentialMeasurement.ino
+ * @brief       Measure the sensor against the internal zero of the LMP91000 instead of ground
+ *
+ *              The LMP91000 output sits on an internal zero voltage derived from the 2.5V
+ *              reference. Normally the library subtracts the nominal zero in software, so any
+ *              drift of the reference reads as gas. If the internal zero (C1) of the breakout
+ *              is wired to AIN1 of the ADS1115, the ADC can subtract the real zero instead.
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Wire C1 of the LMP91000 to AIN1 of the ADS1115 (legacy boards only)
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     Robert @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Tell the library the zero is on AIN1, before begin()
+    if (!sensor.setDifferential(true))
+        Serial.println("This board can't measure differentially!");
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // The reading doesn't carry the zero voltage any more, so a smaller ADC range fits it
+    sensor.setAutoRange(AUTORANGE_PGA);
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Make a reading
+    double reading = sensor.getPPM();
+
+    // Print the reading with 4 digits of precision
+    Serial.print("Reading: ");
+    Serial.print(reading, 4);
+    Serial.println(" PPM");
+
+    // Wait a bit before reading again
+    delay(1000);
+}
@@ -0,0 +1,69 @@
+/**
+ **************************************************
+ *
+ * @file        filteredMeasurement.ino
+ * @brief       See how to filter the readings of a sensor measured in PPB, such as O3 or NO2
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "GasSampleFilter.h"
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_O3);
+
+// The filter which sits between the ADC readings and the PPM calculation
+GasSampleFilter filter;
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Sample faster, the filter averages the samples back down
+    sensor.setDataRate(5); // 250 SPS
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // Reject single-sample spikes with a median of 3 samples
+    filter.setMedian(3);
+    // Average 64 samples into one, this takes about a quarter of a second at 250 SPS
+    filter.setDecimation(64);
+    // Smooth the averaged samples a bit more
+    filter.setEMA(0.3);
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Make the filtered reading
+    double reading = sensor.getFilteredPPM(filter) * 1000.0;
+
+    // Print the reading with 3 digits of precision
+    Serial.print("Sensor reading: ");
+    Serial.print(reading, 3);
+    Serial.println(" PPB");
+
+    // Wait a bit before reading again
+    delay(1000);
+}
@@ -0,0 +1,80 @@
+/**
+ **************************************************
+ *
+ * @file        gasAlarm.ino
+ * @brief       See how to let the ADC watch the gas concentration and signal an alarm on the ALERT/RDY pin
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Connect the ALERT/RDY pin to a GPIO pin
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Note: the hardware alarm is only supported on legacy direct-wired boards.
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// The pin connected to ALERT/RDY, it's pulled LOW while the alarm is active
+#define ALERT_PIN 2
+
+// The alarm goes off if the concentration leaves this range
+// A low limit of 0 only alarms above HIGH_PPM, clean air readings hover around 0 and would trigger it
+#define LOW_PPM  0.0
+#define HIGH_PPM 35.0
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // ALERT/RDY is open drain, so it needs a pull-up
+    pinMode(ALERT_PIN, INPUT_PULLUP);
+
+    // Let the ADC watch the thresholds, trigger after 2 readings in a row are out of range
+    if (!sensor.setAlarmThresholdsPPM(LOW_PPM, HIGH_PPM, 2))
+    {
+        Serial.println("ERROR: Hardware alarm is not supported on this board!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Nothing is read from the sensor until the alarm goes off
+    // This could be a wake-up interrupt from sleep instead
+    if (digitalRead(ALERT_PIN) == LOW)
+    {
+        // Release the alarm and see what the concentration was
+        double reading = sensor.clearAlarm();
+
+        Serial.print("ALARM! Sensor reading: ");
+        Serial.print(reading, 5);
+        Serial.println(" PPM");
+    }
+
+    delay(1000);
+}
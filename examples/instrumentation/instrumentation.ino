@@ -0,0 +1,107 @@
+/**
+ **************************************************
+ *
+ * @file        instrumentation.ino
+ * @brief       Count the I2C traffic of the sensor and see how long its operations take
+ *
+ *              To successfully run the sketch:
+ *              - Uncomment ELECTROCHEMICAL_SENSOR_STATS in ElectrochemicalSensorStats.h in the library's 'src' folder
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+// How many measurements to make between two printouts
+#define MEASUREMENTS_PER_REPORT 10
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+// Print the min/avg/max of one operation
+void printLatency(const char *name, const LatencyStats &latency)
+{
+    Serial.print(name);
+    if (latency.count == 0)
+    {
+        Serial.println(": -");
+        return;
+    }
+    Serial.print(": min ");
+    Serial.print(latency.minUs);
+    Serial.print(" us, avg ");
+    Serial.print(latency.totalUs / latency.count);
+    Serial.print(" us, max ");
+    Serial.print(latency.maxUs);
+    Serial.println(" us");
+}
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Sensor initialized successfully!");
+    printLatency("configureLMP", sensor.getStats().configureLMP);
+}
+
+void loop()
+{
+    // Count only the measurements, not the configuration
+    sensor.resetStats();
+    for (int i = 0; i < MEASUREMENTS_PER_REPORT; i++)
+        sensor.getPPM();
+
+    // Copy the statistics out and print them, printing doesn't distort the measurements this way
+    SensorStats stats = sensor.getStats();
+    Serial.print("I2C writes: ");
+    Serial.print(stats.i2c.writes);
+    Serial.print(", reads: ");
+    Serial.print(stats.i2c.reads);
+    Serial.print(", bytes: ");
+    Serial.print(stats.i2c.bytes);
+    Serial.print(", NACKs: ");
+    Serial.println(stats.i2c.nacks);
+    Serial.print("Bridge BUSY retries: ");
+    Serial.print(stats.bridgeBusyRetries);
+    Serial.print(", timeouts: ");
+    Serial.println(stats.bridgeTimeouts);
+    printLatency("Measurement", stats.measurement);
+    printLatency("Bridge transaction", stats.bridgeTransaction);
+    Serial.println();
+
+    // Wait a bit before measuring again
+    delay(2500);
+}
+#else
+// Without the statistics there's nothing to count, tell the user how to turn them on
+void setup()
+{
+    Serial.begin(115200); // For debugging
+}
+
+void loop()
+{
+    Serial.println("Uncomment ELECTROCHEMICAL_SENSOR_STATS in ElectrochemicalSensorStats.h to run this example");
+    delay(2500);
+}
+#endif
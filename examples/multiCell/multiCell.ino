@@ -0,0 +1,81 @@
+/**
+ **************************************************
+ *
+ * @file        multiCell.ino
+ * @brief       Read up to four sensor cells which share one ADS1115
+ *
+ *              On a carrier board with several LMP91000 front ends, each VOUT can go to
+ *              its own input of one ADS1115. The cells take turns on the ADC, and a
+ *              GasSensorArray schedules them so you get a reading of each one per scan.
+ *
+ *              To successfully run the sketch:
+ *              - Wire VOUT of each LMP91000 to AIN0-AIN3 of the ADS1115
+ *              - Connect MENB of each LMP91000 to its own GPIO pin, they all use the same I2C address
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     Robert @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "GasSensorArray.h"
+
+// The cell on AIN0 is created with the address of the ADS1115 and the MENB pin of its LMP91000
+ElectrochemicalGasSensor co(SENSOR_CO, 0x49, 25);
+
+// The other cells use its ADS1115: the cell they share it with, their input and their MENB pin
+ElectrochemicalGasSensor no2(SENSOR_NO2, co, 1, 26);
+ElectrochemicalGasSensor so2(SENSOR_SO2, co, 2, 27);
+ElectrochemicalGasSensor h2s(SENSOR_H2S, co, 3, 14);
+
+GasSensorArray cells;
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    cells.add(co);
+    cells.add(no2);
+    cells.add(so2);
+    cells.add(h2s);
+
+    // If the inputs have RC filters which need time after the ADC switches to them, uncomment:
+    // for (uint8_t i = 0; i < cells.size(); i++)
+    //     cells.getSensor(i)->setDiscardAfterSwitch(true);
+
+    // Init all of the cells
+    if (!cells.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the cells! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Cells initialized successfully!");
+}
+
+void loop()
+{
+    // Measure each cell once, one after the other on the ADS1115
+    cells.scan();
+
+    // Print the reading of each input
+    for (uint8_t i = 0; i < cells.size(); i++)
+    {
+        Serial.print("AIN");
+        Serial.print(cells.getSensor(i)->getChannel());
+        Serial.print(": ");
+        Serial.print(cells.getPPM(i), 3);
+        Serial.println(" PPM");
+    }
+    Serial.println();
+
+    // Wait a bit before reading again
+    delay(2500);
+}
@@ -0,0 +1,82 @@
+/**
+ **************************************************
+ *
+ * @file        nonBlockingAverage.ino
+ * @brief       See how to make an averaged measurement without blocking the rest of your code
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// How many readings to average from and how long to wait between them
+#define NUM_READINGS        5
+#define MS_BETWEEN_READINGS 2000
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+// Used to show that loop() keeps running while the measurement is in progress
+unsigned long loopCount = 0;
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Sensor initialized successfully!");
+
+    // Start the first averaged measurement
+    sensor.startAveraging(NUM_READINGS, MS_BETWEEN_READINGS);
+}
+
+void loop()
+{
+    // poll() makes a measurement only when it's due, so it returns quickly
+    // and the rest of your code can run in the meantime
+    if (sensor.poll())
+    {
+        double ppm = sensor.getAverageResult();
+        if (ppm < 0)
+        {
+            // Every measurement failed, e.g. the breakout was disconnected
+            Serial.println("ERROR: Can't read the sensor! Check connections!");
+        }
+        else
+        {
+            // Print the reading with 5 digits of precision
+            Serial.print("Sensor reading: ");
+            Serial.print(ppm, 5);
+            Serial.print(" PPM (loop ran ");
+            Serial.print(loopCount);
+            Serial.println(" times meanwhile)");
+        }
+
+        // Start the next averaged measurement
+        loopCount = 0;
+        sensor.startAveraging(NUM_READINGS, MS_BETWEEN_READINGS);
+    }
+
+    // Do other work here
+    loopCount++;
+}
@@ -0,0 +1,75 @@
+/**
+ **************************************************
+ *
+ * @file        sensorArray.ino
+ * @brief       See how to read many sensors on one bus at once with GasSensorArray
+ *
+ *              To successfully run the sketch:
+ *              - Set a different address on each breakout using the jumpers on the back
+ *              - Connect the breakouts to your Dasduino board via easyC
+ *              - On legacy boards, connect LMPEN pins to a GPIO pin so the breakouts can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "GasSensorArray.h"
+
+// Legacy direct-wired boards and ATtiny bridge boards can be on the same bus
+ElectrochemicalGasSensor sensorCO(SENSOR_CO, 0x4A, 25);
+ElectrochemicalGasSensor sensorNO2(SENSOR_NO2, 0x49, 32);
+ElectrochemicalGasSensor sensorSO2(SENSOR_SO2, 0x30);
+ElectrochemicalGasSensor sensorO3(SENSOR_O3, 0x31);
+
+// The array which reads all of them together
+GasSensorArray sensors;
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Add the sensors to the array, the index is the order they're added in
+    sensors.add(sensorCO);
+    sensors.add(sensorNO2);
+    sensors.add(sensorSO2);
+    sensors.add(sensorO3);
+
+    // Init all breakouts, legacy boards with the same sensor type get their LMP91000 configured together
+    if (!sensors.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensors! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Sensors initialized successfully!");
+}
+
+void loop()
+{
+    // Start the conversion on all the sensors and wait for all of them
+    // This takes about as long as reading a single sensor
+    if (!sensors.scan())
+        Serial.println("WARNING: Some readings failed!");
+
+    // Print the readings with 5 digits of precision
+    for (uint8_t i = 0; i < sensors.size(); i++)
+    {
+        Serial.print("Sensor ");
+        Serial.print(i);
+        Serial.print(" reading: ");
+        Serial.print(sensors.getPPM(i), 5);
+        Serial.println(" PPM");
+    }
+
+    // Wait a bit before reading again
+    delay(2500);
+}
@@ -0,0 +1,92 @@
+/**
+ **************************************************
+ *
+ * @file        streaming.ino
+ * @brief       See how to sample the sensor quickly with the continuous conversion streaming mode
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Optionally on legacy boards, connect ALERT/RDY to an interrupt pin and set RDY_PIN below.
+ *              On ATtiny bridge boards, the bridge collects the samples and they're read in bursts.
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// ADS1115 data rate, 0 (8 SPS) to 7 (860 SPS)
+#define STREAM_DATA_RATE 5 // 250 SPS
+
+// If the ALERT/RDY pin of the breakout is connected to an interrupt capable GPIO,
+// set it here so samples are only read when the ADC signals they're ready
+// #define RDY_PIN 2
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+// Samples are copied here from the sensor's buffer
+int16_t samples[16];
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // Put the ADC in continuous conversion mode
+#ifdef RDY_PIN
+    if (!sensor.startInterruptStreaming(RDY_PIN, STREAM_DATA_RATE))
+#else
+    if (!sensor.startStreaming(STREAM_DATA_RATE))
+#endif
+    {
+        Serial.println("ERROR: Can't start streaming! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Read a new sample into the buffer if one is due, this has to be called often
+    sensor.updateStreaming();
+
+    // Once enough samples are collected, take them out and find the peak
+    if (sensor.availableSamples() >= 16)
+    {
+        uint8_t n = sensor.readSamples(samples, 16);
+
+        int16_t peak = samples[0];
+        for (uint8_t i = 1; i < n; i++)
+        {
+            if (samples[i] > peak)
+                peak = samples[i];
+        }
+
+        // Print the peak reading with 5 digits of precision
+        Serial.print("Peak of ");
+        Serial.print(n);
+        Serial.print(" samples: ");
+        Serial.print(sensor.rawToPPM(peak), 5);
+        Serial.println(" PPM");
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ **************************************************
+ *
+ * @file        temperatureCompensation.ino
+ * @brief       Measure the temperature with the LMP91000 and get temperature compensated PPM
+ *
+ *              The sensitivity of electrochemical cells changes with the temperature. The LMP91000
+ *              has a temperature sensor of its own, so the library can measure it every few gas
+ *              readings and correct the PPM without an external sensor.
+ *
+ *              The library doesn't come with temperature curves, they have to be taken from the
+ *              datasheet of your cell. Until you fill them in below, the PPM stays uncompensated.
+ *
+ *              To successfully run the sketch:
+ *              - Connect the breakout to your Dasduino board via easyC
+ *              - Connect LMPEN pin to GND or a GPIO pin so the breakout can be configured
+ *              - Run the sketch and open serial monitor at 115200 baud!
+ *
+ *              Electrochemical Gas Sensor Breakout: solde.red/333218
+ *              Dasduino Core: www.solde.red/333037
+ *              Dasduino Connect: www.solde.red/333034
+ *              Dasduino ConnectPlus: www.solde.red/333033
+ *
+ * @authors     Robert @ soldered.com
+ ***************************************************/
+
+// Include the required library
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// Measure the temperature once every this many gas readings
+#define READINGS_PER_TEMPERATURE 10
+
+// Configurations for each of the sensor types are in sensorConfigData.h in the library's 'src' folder
+// Create the sensor object with the according type
+ElectrochemicalGasSensor sensor(SENSOR_CO);
+
+// Temperature curve of the cell, relative to the output at the calibration temperature
+// Copy it from the datasheet of your cell, one point every 10 degrees from -20 to 50
+// These placeholders change nothing: the same sensitivity as at calibration and no zero drift
+const float coSensitivity[] = {1.00F, 1.00F, 1.00F, 1.00F, 1.00F, 1.00F, 1.00F, 1.00F};
+// What the cell reads in clean air at each of the points, leave it out (nullptr) if the datasheet doesn't list it
+const float coZeroPpm[] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+const temperatureCurve coCurve = {-20, 10, 8, coSensitivity, coZeroPpm};
+
+void setup()
+{
+    Serial.begin(115200); // For debugging
+
+    // Init the breakout
+    if (!sensor.begin())
+    {
+        // Can't init? Notify the user and go to infinite loop
+        Serial.println("ERROR: Can't init the sensor! Check connections!");
+        while (true)
+            delay(100);
+    }
+
+    // Set the curve and how often to measure the temperature, from now on the PPM is compensated
+    sensor.setTemperatureCurve(&coCurve);
+    sensor.setTemperatureInterval(READINGS_PER_TEMPERATURE);
+
+    Serial.println("Sensor initialized successfully!");
+}
+
+void loop()
+{
+    // Make a reading, every READINGS_PER_TEMPERATURE-th one also measures the temperature first
+    double reading = sensor.getPPM();
+
+    // Print the reading with 3 digits of precision
+    Serial.print("Reading: ");
+    Serial.print(reading, 3);
+    Serial.print(" PPM at ");
+    Serial.print(sensor.getTemperature(), 1);
+    Serial.println(" C");
+
+    // Wait a bit before reading again
+    delay(1000);
+}
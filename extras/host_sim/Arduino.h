@@ -0,0 +1,110 @@
+/**
+ **************************************************
+ *
+ * @file        Arduino.h
+ * @brief       Minimal Arduino core for building the library on a Linux host.
+ *
+ *              Only what the library uses is here. Time is simulated, see SimBus.h.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __HOST_SIM_ARDUINO_H__
+#define __HOST_SIM_ARDUINO_H__
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F(x) (x)
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+// Serial prints to stdout
+class HardwareSerial
+{
+  public:
+    void begin(unsigned long)
+    {
+    }
+    void print(const char *s)
+    {
+        fputs(s, stdout);
+    }
+    void print(int v)
+    {
+        printf("%d", v);
+    }
+    void print(unsigned int v)
+    {
+        printf("%u", v);
+    }
+    void print(long v)
+    {
+        printf("%ld", v);
+    }
+    void print(unsigned long v)
+    {
+        printf("%lu", v);
+    }
+    void print(double v, int digits = 2)
+    {
+        printf("%.*f", digits, v);
+    }
+    void println()
+    {
+        fputs("\n", stdout);
+    }
+    template <class T> void println(T v)
+    {
+        print(v);
+        println();
+    }
+    template <class T> void println(T v, int digits)
+    {
+        print(v, digits);
+        println();
+    }
+    operator bool()
+    {
+        return true;
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,857 @@
+/**
+ * **************************************************
+ *
+ * @file        SimBus.cpp
+ * @brief       Simulated Arduino core, TwoWire, I2C bus and chip models.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#include "SimBus.h"
+#include "Wire.h"
+#include <stdlib.h>
+
+// Bridge protocol values, see Electrochemical-Gas-Sensor-SOLDERED.h
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// --- Simulated time, pins and interrupts ---
+
+static uint64_t nowUs = 0;
+static uint8_t pins[256];
+static uint8_t pinModes[256]; // all INPUT after reset
+static void (*pinIsrs[256])(void);
+static int pinIsrModes[256];
+
+// ADS1115 models which convert on their own between bus transactions
+#define SIM_MAX_TIMED 16
+static SimADS1115 *timed[SIM_MAX_TIMED];
+
+static void tick()
+{
+    for (uint8_t i = 0; i < SIM_MAX_TIMED; i++)
+    {
+        if (timed[i] != nullptr)
+            timed[i]->tick();
+    }
+}
+
+uint64_t simNowUs()
+{
+    return nowUs;
+}
+
+void simAdvanceUs(uint64_t us)
+{
+    nowUs += us;
+    tick();
+}
+
+int simPinState(uint8_t pin)
+{
+    return pins[pin];
+}
+
+int simPinMode(uint8_t pin)
+{
+    return pinModes[pin];
+}
+
+void simDrivePin(uint8_t pin, int level)
+{
+    int old = pins[pin];
+    pins[pin] = level;
+    void (*isr)(void) = pinIsrs[pin];
+    if (isr == nullptr || old == level)
+        return;
+    int mode = pinIsrModes[pin];
+    if (mode == CHANGE || (mode == RISING && level == HIGH) || (mode == FALLING && level == LOW))
+        isr();
+}
+
+uint32_t simConversionTimeUs(uint8_t dataRate)
+{
+    static const uint16_t samplesPerSecond[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return 1000000UL / samplesPerSecond[dataRate & 0x07];
+}
+
+// Every call to the clock costs a microsecond, so busy loops always make progress
+unsigned long millis()
+{
+    nowUs += 1;
+    tick();
+    return (unsigned long)(nowUs / 1000);
+}
+
+unsigned long micros()
+{
+    nowUs += 1;
+    tick();
+    return (unsigned long)nowUs;
+}
+
+void delay(unsigned long ms)
+{
+    nowUs += (uint64_t)ms * 1000;
+    tick();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    nowUs += us;
+    tick();
+}
+
+void yield()
+{
+    nowUs += 1;
+    tick();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    pinModes[pin] = mode;
+    if (mode == INPUT_PULLUP)
+        pins[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    pins[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pins[pin];
+}
+
+// Interrupt numbers are the pin numbers
+int digitalPinToInterrupt(uint8_t pin)
+{
+    return pin;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode)
+{
+    pinIsrs[interrupt] = isr;
+    pinIsrModes[interrupt] = mode;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+    pinIsrs[interrupt] = nullptr;
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+HardwareSerial Serial;
+
+// --- TwoWire ---
+
+static SimBus defaultBus;
+static SimBus defaultBus1;
+TwoWire Wire(&defaultBus);
+TwoWire Wire1(&defaultBus1);
+
+TwoWire::TwoWire(SimBus *_bus)
+{
+    bus = _bus;
+    txAddress = 0;
+    txLength = 0;
+    rxLength = 0;
+    rxIndex = 0;
+}
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::end()
+{
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+    bus->clockHz = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    txAddress = address;
+    txLength = 0;
+}
+
+void TwoWire::beginTransmission(int address)
+{
+    beginTransmission((uint8_t)address);
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+    // Same return values as the AVR core: 0 = OK, 2 = address NACK
+    return bus->write(txAddress, txBuffer, txLength) ? 0 : 2;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (txLength >= WIRE_BUFFER_SIZE)
+        return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+    size_t n = 0;
+    while (n < quantity && write(data[n]))
+        n++;
+    return n;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t)
+{
+    if (quantity > WIRE_BUFFER_SIZE)
+        quantity = WIRE_BUFFER_SIZE;
+    rxLength = bus->read(address, rxBuffer, quantity);
+    rxIndex = 0;
+    return rxLength;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
+{
+    return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+}
+
+int TwoWire::available()
+{
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read()
+{
+    if (rxIndex >= rxLength)
+        return -1;
+    return rxBuffer[rxIndex++];
+}
+
+// --- Bus ---
+
+SimBus::SimBus()
+{
+    clockHz = 100000;
+    count = 0;
+    resetStats();
+}
+
+void SimBus::attach(uint8_t address, SimDevice *device)
+{
+    if (count >= SIM_BUS_MAX_DEVICES)
+        return;
+    addresses[count] = address;
+    devices[count] = device;
+    count++;
+}
+
+void SimBus::detachAll()
+{
+    count = 0;
+}
+
+void SimBus::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Start, address + R/W, ACKs and stop, 9 clocks per byte
+void SimBus::account(uint8_t len)
+{
+    stats.bytes += len + 1;
+    nowUs += ((uint64_t)(len + 1) * 9 + 2) * 1000000ULL / clockHz;
+}
+
+bool SimBus::write(uint8_t address, const uint8_t *data, uint8_t len)
+{
+    stats.writes++;
+    bool acked = false;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (addresses[i] == address && devices[i]->enabled())
+        {
+            devices[i]->onWrite(data, len);
+            acked = true;
+        }
+    }
+    account(acked ? len : 0);
+    if (!acked)
+        stats.nacks++;
+    return acked;
+}
+
+uint8_t SimBus::read(uint8_t address, uint8_t *data, uint8_t len)
+{
+    stats.reads++;
+
+    // Open-drain bus: when several devices answer at once (e.g. LMP91000s with their MENB low
+    // together), a bit is only read as 1 if all of them send a 1
+    bool answered = false;
+    uint8_t n = 0;
+    uint8_t other[32];
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (addresses[i] != address || !devices[i]->enabled())
+            continue;
+        if (!answered)
+        {
+            n = devices[i]->onRead(data, len);
+            answered = true;
+            continue;
+        }
+        uint8_t m = devices[i]->onRead(other, len < sizeof(other) ? len : sizeof(other));
+        for (uint8_t j = 0; j < n && j < m; j++)
+            data[j] &= other[j];
+    }
+    account(n);
+    if (!answered)
+        stats.nacks++;
+    return n;
+}
+
+// --- Analog input ---
+
+double SimAnalog::sample()
+{
+    if (noiseVolts == 0)
+        return volts;
+
+    // Box-Muller with a fixed seed, so runs are repeatable
+    static uint32_t seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    double u1 = ((seed >> 8) + 1.0) / 16777217.0;
+    seed = seed * 1103515245 + 12345;
+    double u2 = ((seed >> 8) + 1.0) / 16777217.0;
+    return volts + noiseVolts * sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+int16_t simVoltsToCode(double volts, uint8_t pga)
+{
+    static const double fullScale[8] = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256};
+    double code = volts / fullScale[pga & 0x07] * 32767.0;
+    if (code > 32767)
+        return 32767;
+    if (code < -32768)
+        return -32768;
+    return (int16_t)lround(code);
+}
+
+double simReferenceVolts = 2.5;
+
+double simZeroVolts(uint8_t refcn)
+{
+    static const double zeroPercent[4] = {20, 50, 67, 0};
+    return simReferenceVolts * zeroPercent[(refcn >> 5) & 0x03] / 100.0;
+}
+
+double simCellVolts(const SimCell *cell, uint8_t tiacn, uint8_t refcn)
+{
+    static const double tiaOhms[8] = {0, 2750, 3500, 7000, 14000, 35000, 120000, 350000};
+    uint8_t code = (tiacn >> 2) & 0x07;
+    double ohms = code == 0 ? cell->externalOhms : tiaOhms[code];
+    double volts = simZeroVolts(refcn) + cell->nanoAmps * 1e-9 * ohms;
+
+    SimAnalog noise = {volts, cell->noiseVolts};
+    volts = noise.sample();
+    if (volts > 3.3)
+        return 3.3;
+    if (volts < 0)
+        return 0;
+    return volts;
+}
+
+double simDieTemperatureC = 25.0;
+
+double simTemperatureVolts()
+{
+    // Linear fit of the LMP91000 temperature sensor transfer table
+    return (1555.0 - 8.0 * simDieTemperatureC) / 1000.0;
+}
+
+bool simIsTemperatureMode(uint8_t modecn)
+{
+    return (modecn & 0x07) == 0x06 || (modecn & 0x07) == 0x07;
+}
+
+// --- ADS1115 ---
+
+#define SIM_ADS_OS        0x8000
+#define SIM_ADS_MODE      0x0100
+#define SIM_ADS_PGA(c)    (((c) >> 9) & 0x07)
+#define SIM_ADS_DR(c)     (((c) >> 5) & 0x07)
+#define SIM_ADS_MUX(c)    (((c) >> 12) & 0x07)
+
+SimADS1115::SimADS1115(SimAnalog *_input)
+{
+    input = _input;
+    config = 0x8583; // datasheet reset value
+    loThresh = 0x8000;
+    hiThresh = 0x7FFF;
+    conversions = 0;
+    pointer = 0;
+    conversion = 0;
+    busyUntilUs = 0;
+    lastConversionUs = 0;
+    converting = false;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        frontEnd[i] = nullptr;
+        cell[i] = nullptr;
+    }
+    zeroOnAin1 = false;
+    switchCarryover = 0;
+    lastMux = 0xFF;
+    lastVolts = 0;
+    alertPin = -1;
+    alertActive = false;
+    alertCount = 0;
+
+    for (uint8_t i = 0; i < SIM_MAX_TIMED; i++)
+    {
+        if (timed[i] == nullptr)
+        {
+            timed[i] = this;
+            break;
+        }
+    }
+}
+
+SimADS1115::~SimADS1115()
+{
+    for (uint8_t i = 0; i < SIM_MAX_TIMED; i++)
+    {
+        if (timed[i] == this)
+            timed[i] = nullptr;
+    }
+}
+
+void SimADS1115::tick()
+{
+    if (alertPin >= 0)
+        update();
+}
+
+#define SIM_ADS_COMP_MODE 0x0010
+#define SIM_ADS_COMP_POL  0x0008
+#define SIM_ADS_COMP_LAT  0x0004
+#define SIM_ADS_COMP_QUE(c) ((c) & 0x03)
+
+void SimADS1115::setAlert(bool active)
+{
+    if (alertPin < 0 || active == alertActive)
+        return;
+    alertActive = active;
+    bool activeHigh = config & SIM_ADS_COMP_POL;
+    simDrivePin(alertPin, active == activeHigh ? HIGH : LOW);
+}
+
+// The comparator after each conversion, or the conversion ready pulse
+void SimADS1115::compare()
+{
+    uint8_t que = SIM_ADS_COMP_QUE(config);
+    if (que == 3)
+    {
+        alertCount = 0;
+        setAlert(false);
+        return;
+    }
+
+    // Hi_thresh MSB = 1 and Lo_thresh MSB = 0: ALERT/RDY pulses after every conversion
+    if ((hiThresh & 0x8000) && !(loThresh & 0x8000))
+    {
+        setAlert(true);
+        setAlert(false);
+        return;
+    }
+
+    int16_t code = conversion;
+    bool window = config & SIM_ADS_COMP_MODE;
+    bool out = code > (int16_t)hiThresh || (window && code < (int16_t)loThresh);
+    if (out)
+    {
+        if (alertCount < 255)
+            alertCount++;
+    }
+    else
+    {
+        alertCount = 0;
+    }
+
+    uint8_t needed = que == 0 ? 1 : (que == 1 ? 2 : 4);
+    if (alertCount >= needed)
+        setAlert(true);
+    else if (!(config & SIM_ADS_COMP_LAT) && (window ? !out : code < (int16_t)loThresh))
+        setAlert(false); // the traditional comparator only lets go below Lo_thresh
+}
+
+// One conversion of the selected input, with what's left of the previous input after a mux switch
+double SimADS1115::convert()
+{
+    double volts = sample();
+    double converted = volts;
+    uint8_t mux = SIM_ADS_MUX(config);
+    if (mux != lastMux && lastMux != 0xFF)
+        converted = volts * (1 - switchCarryover) + lastVolts * switchCarryover;
+    lastMux = mux;
+    lastVolts = volts;
+    return converted;
+}
+
+double SimADS1115::ain(uint8_t channel)
+{
+    if (channel == 1 && zeroOnAin1)
+        return frontEnd[0] != nullptr ? simZeroVolts(frontEnd[0]->regs[0x11]) : 0;
+
+    SimLMP91000 *lmp = frontEnd[channel];
+    if (lmp != nullptr && simIsTemperatureMode(lmp->regs[0x12]))
+        return simTemperatureVolts();
+    if (lmp != nullptr && cell[channel] != nullptr)
+        return simCellVolts(cell[channel], lmp->regs[0x10], lmp->regs[0x11]);
+    return channel == 0 ? input->sample() : 0;
+}
+
+// The input selected by the mux
+double SimADS1115::sample()
+{
+    uint8_t mux = SIM_ADS_MUX(config);
+    switch (mux)
+    {
+    case 0:
+        return ain(0) - ain(1);
+    case 1:
+    case 2:
+    case 3:
+        return ain(mux - 1) - ain(3);
+    default: // single-ended AIN0 to AIN3
+        return ain(mux - 4);
+    }
+}
+
+// Finish a single-shot conversion, or catch up on continuous ones
+void SimADS1115::update()
+{
+    if ((config & SIM_ADS_MODE) == 0)
+    {
+        uint32_t period = simConversionTimeUs(SIM_ADS_DR(config));
+        while (nowUs - lastConversionUs >= period)
+        {
+            lastConversionUs += period;
+            conversion = simVoltsToCode(convert(), SIM_ADS_PGA(config));
+            conversions++;
+            compare();
+        }
+        return;
+    }
+
+    if (converting && nowUs >= busyUntilUs)
+    {
+        conversion = simVoltsToCode(convert(), SIM_ADS_PGA(config));
+        conversions++;
+        converting = false;
+        compare();
+    }
+}
+
+void SimADS1115::onWrite(const uint8_t *data, uint8_t len)
+{
+    update();
+    if (len == 0)
+        return;
+    pointer = data[0] & 0x03;
+    if (len < 3)
+        return;
+
+    uint16_t value = ((uint16_t)data[1] << 8) | data[2];
+    switch (pointer)
+    {
+    case 1:
+        config = value & ~SIM_ADS_OS;
+        if (SIM_ADS_COMP_QUE(config) == 3)
+            compare(); // disabling the comparator releases ALERT/RDY
+        if (config & SIM_ADS_MODE)
+        {
+            if (value & SIM_ADS_OS)
+            {
+                converting = true;
+                busyUntilUs = nowUs + simConversionTimeUs(SIM_ADS_DR(config));
+            }
+        }
+        else
+        {
+            lastConversionUs = nowUs;
+        }
+        break;
+    case 2:
+        loThresh = value;
+        break;
+    case 3:
+        hiThresh = value;
+        break;
+    }
+}
+
+uint8_t SimADS1115::onRead(uint8_t *data, uint8_t len)
+{
+    update();
+    uint16_t value;
+    switch (pointer)
+    {
+    case 0:
+        value = (uint16_t)conversion;
+        // Reading the conversion releases a latched ALERT/RDY, the next conversion out of range latches it again
+        if (config & SIM_ADS_COMP_LAT)
+            setAlert(false);
+        break;
+    case 1:
+        value = config | (converting ? 0 : SIM_ADS_OS);
+        break;
+    case 2:
+        value = loThresh;
+        break;
+    default:
+        value = hiThresh;
+        break;
+    }
+    uint8_t n = len < 2 ? len : 2;
+    if (n > 0)
+        data[0] = value >> 8;
+    if (n > 1)
+        data[1] = value & 0xFF;
+    return n;
+}
+
+// --- LMP91000 ---
+
+SimLMP91000::SimLMP91000(int _menbPin)
+{
+    menbPin = _menbPin;
+    memset(regs, 0, sizeof(regs));
+    regs[0x00] = 0x01; // ready
+    regs[0x01] = 0x01; // locked
+    regs[0x10] = 0x03;
+    regs[0x11] = 0x20;
+    regs[0x12] = 0x00;
+    registerWrites = 0;
+    pointer = 0;
+}
+
+bool SimLMP91000::enabled()
+{
+    return menbPin < 0 || simPinState(menbPin) == LOW;
+}
+
+void SimLMP91000::onWrite(const uint8_t *data, uint8_t len)
+{
+    if (len == 0)
+        return;
+    pointer = data[0];
+    if (len < 2 || pointer >= sizeof(regs))
+        return;
+
+    // TIACN and REFCN are write protected while locked, STATUS is read only
+    if (pointer == 0x00)
+        return;
+    if ((pointer == 0x10 || pointer == 0x11) && regs[0x01])
+        return;
+    regs[pointer] = data[1];
+    registerWrites++;
+}
+
+uint8_t SimLMP91000::onRead(uint8_t *data, uint8_t len)
+{
+    if (len == 0)
+        return 0;
+    data[0] = pointer < sizeof(regs) ? regs[pointer] : 0;
+    return 1;
+}
+
+// --- ATtiny bridge ---
+
+SimBridge::SimBridge(SimAnalog *_input)
+{
+    input = _input;
+    legacyFirmware = false;
+    unresponsive = false;
+    registerLatencyUs = 300;
+    commands = 0;
+    gain = 0;
+    dataRate = 0;
+    tiacn = refcn = modecn = 0;
+    status = BRIDGE_STATUS_NONE;
+    result = 0;
+    busyUntilUs = 0;
+    conversionPending = false;
+    readStreamNext = false;
+    readStreamMax = 0;
+    streaming = false;
+    streamNextUs = 0;
+    fifoCount = 0;
+    configured = false;
+    cell = nullptr;
+}
+
+int16_t SimBridge::convert()
+{
+    // Same gain indexes as ADS1X15::setGain()
+    uint8_t pga = gain == 1 ? 1 : gain == 2 ? 2 : gain == 4 ? 3 : gain == 8 ? 4 : gain == 16 ? 5 : 0;
+    if (simIsTemperatureMode(modecn))
+        return simVoltsToCode(simTemperatureVolts(), pga);
+    if (cell != nullptr)
+        return simVoltsToCode(simCellVolts(cell, tiacn, refcn), pga);
+    return simVoltsToCode(input->sample(), pga);
+}
+
+void SimBridge::updateStream()
+{
+    if (!streaming)
+        return;
+    uint32_t period = simConversionTimeUs(dataRate);
+    while (nowUs >= streamNextUs)
+    {
+        streamNextUs += period;
+        if (fifoCount < sizeof(fifo) / sizeof(fifo[0]))
+            fifo[fifoCount++] = (uint16_t)convert();
+    }
+}
+
+void SimBridge::onWrite(const uint8_t *data, uint8_t len)
+{
+    updateStream();
+    if (len == 0)
+        return;
+
+    commands++;
+    uint8_t cmd = data[0];
+    status = BRIDGE_STATUS_BUSY;
+    result = 0;
+    conversionPending = false;
+    busyUntilUs = nowUs + registerLatencyUs;
+
+    bool batched = cmd == CMD_CONFIGURE_ALL || cmd == CMD_CONFIGURE_AND_TRIGGER || cmd == CMD_START_STREAM ||
+                   cmd == CMD_STOP_STREAM || cmd == CMD_READ_STREAM;
+    if (legacyFirmware && batched)
+    {
+        status = BRIDGE_STATUS_ERROR;
+        return;
+    }
+
+    switch (cmd)
+    {
+    case CMD_PING:
+        break;
+    case CMD_CONFIGURE_ADC:
+        if (len >= 3)
+        {
+            gain = data[1];
+            dataRate = data[2];
+        }
+        break;
+    case CMD_CONFIGURE_LMP:
+        if (len >= 4)
+        {
+            tiacn = data[1];
+            refcn = data[2];
+            modecn = data[3];
+        }
+        break;
+    case CMD_CONFIGURE_ALL:
+    case CMD_CONFIGURE_AND_TRIGGER:
+        if (len >= 6)
+        {
+            bool unchanged = configured && gain == data[1] && dataRate == data[2] && tiacn == data[3] &&
+                             refcn == data[4] && modecn == data[5];
+            if (cmd == CMD_CONFIGURE_ALL && unchanged)
+                result = (uint16_t)BRIDGE_CONFIG_UNCHANGED << 8;
+            configured = true;
+            gain = data[1];
+            dataRate = data[2];
+            tiacn = data[3];
+            refcn = data[4];
+            modecn = data[5];
+        }
+        if (cmd == CMD_CONFIGURE_ALL)
+            break;
+        // fall through
+    case CMD_TRIGGER_ADC:
+        conversionPending = true;
+        busyUntilUs += simConversionTimeUs(dataRate);
+        break;
+    case CMD_START_STREAM:
+        if (len >= 2)
+            dataRate = data[1];
+        streaming = true;
+        fifoCount = 0;
+        streamNextUs = nowUs + simConversionTimeUs(dataRate);
+        break;
+    case CMD_STOP_STREAM:
+        streaming = false;
+        break;
+    case CMD_READ_STREAM:
+        readStreamNext = true;
+        readStreamMax = len >= 2 ? data[1] : 0;
+        break;
+    default:
+        status = BRIDGE_STATUS_ERROR;
+        break;
+    }
+}
+
+uint8_t SimBridge::onRead(uint8_t *data, uint8_t len)
+{
+    updateStream();
+
+    // The I2C hardware still acknowledges, but the firmware never gets to the command
+    if (unresponsive)
+    {
+        memset(data, 0, len);
+        data[0] = BRIDGE_STATUS_BUSY;
+        return len;
+    }
+
+    if (readStreamNext)
+    {
+        readStreamNext = false;
+        uint8_t n = fifoCount;
+        if (n > readStreamMax)
+            n = readStreamMax;
+        if (2 + 2 * n > len)
+            n = (len - 2) / 2;
+
+        data[0] = BRIDGE_STATUS_OK;
+        data[1] = n;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            data[2 + 2 * i] = fifo[i] >> 8;
+            data[3 + 2 * i] = fifo[i] & 0xFF;
+        }
+        memmove(fifo, fifo + n, (fifoCount - n) * sizeof(fifo[0]));
+        fifoCount -= n;
+        return 2 + 2 * n;
+    }
+
+    if (status == BRIDGE_STATUS_BUSY && nowUs >= busyUntilUs)
+    {
+        if (conversionPending)
+            result = (uint16_t)convert();
+        status = BRIDGE_STATUS_OK;
+    }
+
+    uint8_t response[3] = {status, (uint8_t)(result >> 8), (uint8_t)(result & 0xFF)};
+    uint8_t n = len < 3 ? len : 3;
+    memcpy(data, response, n);
+    return n;
+}
@@ -0,0 +1,218 @@
+/**
+ **************************************************
+ *
+ * @file        SimBus.h
+ * @brief       Simulated I2C bus, simulated time and models of the chips on the breakout.
+ *
+ *              Models: ADS1115 (registers, single-shot and continuous conversions, PGA, comparator and ALERT/RDY),
+ *              LMP91000 (register map, lock, MENB pin, temperature sensor on VOUT) and the ATtiny bridge protocol
+ *              (BUSY latency, batched commands, streaming FIFO, old firmware, unresponsive board).
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __HOST_SIM_SIM_BUS_H__
+#define __HOST_SIM_SIM_BUS_H__
+
+#include "Arduino.h"
+
+// --- Simulated time and pins ---
+
+uint64_t simNowUs();
+void simAdvanceUs(uint64_t us);
+int simPinState(uint8_t pin);
+int simPinMode(uint8_t pin);
+// Drive a pin from a chip model, runs the ISR attached to it on a matching edge
+void simDrivePin(uint8_t pin, int level);
+
+// ADS1115 samples per second for each data rate setting
+uint32_t simConversionTimeUs(uint8_t dataRate);
+
+// --- Bus ---
+
+class SimDevice
+{
+  public:
+    virtual ~SimDevice()
+    {
+    }
+    // Devices which share an address (LMP91000s behind MENB) only answer while enabled
+    virtual bool enabled()
+    {
+        return true;
+    }
+    virtual void onWrite(const uint8_t *data, uint8_t len) = 0;
+    virtual uint8_t onRead(uint8_t *data, uint8_t len) = 0;
+};
+
+struct SimBusStats
+{
+    uint32_t writes; // write transactions, ACKed or not
+    uint32_t reads;  // read transactions, ACKed or not
+    uint32_t nacks;  // transactions nobody answered
+    uint32_t bytes;  // bytes on the wire, including the address byte
+};
+
+#define SIM_BUS_MAX_DEVICES 32
+
+class SimBus
+{
+  public:
+    SimBus();
+    void attach(uint8_t address, SimDevice *device);
+    void detachAll();
+    bool write(uint8_t address, const uint8_t *data, uint8_t len);
+    uint8_t read(uint8_t address, uint8_t *data, uint8_t len);
+    void resetStats();
+
+    SimBusStats stats;
+    uint32_t clockHz;
+
+  private:
+    uint8_t addresses[SIM_BUS_MAX_DEVICES];
+    SimDevice *devices[SIM_BUS_MAX_DEVICES];
+    uint8_t count;
+    void account(uint8_t len);
+};
+
+// --- Analog input shared by the models ---
+
+// The voltage the ADC sees on its input, plus gaussian noise
+struct SimAnalog
+{
+    double volts;
+    double noiseVolts;
+    double sample();
+};
+
+// Raw ADS1115 code for a voltage at a PGA setting (config register bits 9-11)
+int16_t simVoltsToCode(double volts, uint8_t pga);
+
+// A cell behind the LMP91000: its current through the TIA gain of TIACN, around the internal zero of REFCN.
+// The output is clipped at the rails like the real TIA, so ranging of the front end can be tested
+struct SimCell
+{
+    double nanoAmps;
+    double noiseVolts;
+    double externalOhms; // the resistor of a board with TIA_GAIN_EXTERNAL, 0 if there is none
+};
+
+// VOUT of an LMP91000 with a cell, for its TIACN and REFCN
+double simCellVolts(const SimCell *cell, uint8_t tiacn, uint8_t refcn);
+
+// Internal zero of an LMP91000 for its REFCN, as seen on C1
+double simZeroVolts(uint8_t refcn);
+
+// The 2.5V reference of every LMP91000, change it to simulate drift
+extern double simReferenceVolts;
+
+// Die temperature of every LMP91000, 25 by default
+extern double simDieTemperatureC;
+
+// VOUT of an LMP91000 in one of the temperature modes
+double simTemperatureVolts();
+
+// True if the MODECN value selects one of the temperature modes
+bool simIsTemperatureMode(uint8_t modecn);
+
+// --- Chip models ---
+
+class SimLMP91000;
+
+class SimADS1115 : public SimDevice
+{
+  public:
+    explicit SimADS1115(SimAnalog *_input);
+    ~SimADS1115();
+    void onWrite(const uint8_t *data, uint8_t len);
+    uint8_t onRead(uint8_t *data, uint8_t len);
+    // Catch up on the conversions, the simulated clock calls it so ALERT/RDY fires without bus traffic
+    void tick();
+
+    uint16_t config;
+    uint16_t loThresh;
+    uint16_t hiThresh;
+    uint32_t conversions;
+    // The LMP91000 driving each input, to follow its temperature mode, and the cell behind it.
+    // Input 0 reads the fixed input without a cell, the others read 0V without a front end.
+    SimLMP91000 *frontEnd[4];
+    SimCell *cell[4];
+    bool zeroOnAin1; // the internal zero of frontEnd[0] is wired to AIN1, for differential readings
+    // Part of the previous input which is still in the first conversion after the mux switched,
+    // like an RC filter on the inputs would leave, 0 by default
+    double switchCarryover;
+    // Pin the open-drain ALERT/RDY output is wired to, -1 if it isn't. Released means HIGH (pull-up)
+    int alertPin;
+
+  private:
+    SimAnalog *input;
+    bool alertActive;
+    uint8_t alertCount; // out-of-range conversions in a row
+    void compare();
+    void setAlert(bool active);
+    double sample();
+    double ain(uint8_t channel);
+    double convert();
+    uint8_t lastMux;
+    double lastVolts;
+    uint8_t pointer;
+    int16_t conversion;
+    uint64_t busyUntilUs;
+    uint64_t lastConversionUs;
+    bool converting;
+    void update();
+};
+
+class SimLMP91000 : public SimDevice
+{
+  public:
+    explicit SimLMP91000(int _menbPin = -1);
+    bool enabled();
+    void onWrite(const uint8_t *data, uint8_t len);
+    uint8_t onRead(uint8_t *data, uint8_t len);
+
+    uint8_t regs[0x13];
+    uint32_t registerWrites;
+
+  private:
+    int menbPin;
+    uint8_t pointer;
+};
+
+class SimBridge : public SimDevice
+{
+  public:
+    explicit SimBridge(SimAnalog *_input);
+    void onWrite(const uint8_t *data, uint8_t len);
+    uint8_t onRead(uint8_t *data, uint8_t len);
+
+    bool legacyFirmware; // doesn't know the batched and streaming commands
+    bool unresponsive;   // acknowledges but stays BUSY, to test timeouts
+    uint32_t registerLatencyUs;
+    uint32_t commands;
+
+    uint8_t gain;
+    uint8_t dataRate;
+    uint8_t tiacn, refcn, modecn;
+    bool configured; // set by CMD_CONFIGURE_ALL, survives a restart of the host like on the real board
+    SimCell *cell;   // instead of the fixed input, may be nullptr
+
+  private:
+    SimAnalog *input;
+    uint8_t status;
+    uint16_t result;
+    uint64_t busyUntilUs;
+    bool conversionPending;
+    bool readStreamNext;
+    uint8_t readStreamMax;
+    bool streaming;
+    uint64_t streamNextUs;
+    uint16_t fifo[64];
+    uint8_t fifoCount;
+    void updateStream();
+    int16_t convert();
+};
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ **************************************************
+ *
+ * @file        Wire.h
+ * @brief       TwoWire for the host simulator, all the traffic goes to a SimBus.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __HOST_SIM_WIRE_H__
+#define __HOST_SIM_WIRE_H__
+
+#include "Arduino.h"
+
+class SimBus;
+
+// Same buffer size as the AVR core
+#define WIRE_BUFFER_SIZE 32
+
+class TwoWire
+{
+  public:
+    explicit TwoWire(SimBus *_bus);
+    void begin();
+    void end();
+    void setClock(uint32_t clock);
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address);
+    uint8_t endTransmission(bool sendStop = true);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t quantity);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = true);
+    uint8_t requestFrom(int address, int quantity, int sendStop = true);
+    int available();
+    int read();
+
+    SimBus *bus;
+
+  private:
+    uint8_t txAddress;
+    uint8_t txBuffer[WIRE_BUFFER_SIZE];
+    uint8_t txLength;
+    uint8_t rxBuffer[WIRE_BUFFER_SIZE];
+    uint8_t rxLength;
+    uint8_t rxIndex;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
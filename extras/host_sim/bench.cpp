@@ -0,0 +1,905 @@
+/**
+ * **************************************************
+ *
+ * @file        bench.cpp
+ * @brief       Benchmarks of the measurement path on the host simulator.
+ *
+ *              For each transport mode and configuration, reports the I2C transactions,
+ *              bytes on the wire, simulated wall time and host CPU time per reading.
+ *              Checks which don't hold are marked FAILED and make the exit status 1.
+ *              Build and run with "make run" in this folder.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "GasSampleFilter.h"
+#include "GasSensorArray.h"
+#include "SimBus.h"
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+// Input of 0.6V on every ADC, a bit above the 20% internal zero of most configs
+static SimAnalog analog = {0.6, 0.0005};
+
+// Checks which didn't hold, every label with FAILED in it counts
+static uint32_t failures = 0;
+
+static uint64_t hostNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t hostCycles()
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return hostNs();
+#endif
+}
+
+// Snapshot of the bus and the clocks, to report what happened in between
+struct Mark
+{
+    SimBusStats bus;
+    uint64_t simUs;
+    uint64_t ns;
+
+    static Mark now()
+    {
+        Mark m;
+        m.bus = Wire.bus->stats;
+        m.simUs = simNowUs();
+        m.ns = hostNs();
+        return m;
+    }
+};
+
+static void printHeader()
+{
+    printf("%-44s %8s %8s %8s %12s %10s\n", "benchmark (per reading)", "I2C tx", "bytes", "NACKs", "sim time us",
+           "host ns");
+}
+
+// idleUs is simulated time the benchmark waited on its own, it's not counted
+static void report(const char *name, const Mark &start, uint32_t readings, uint64_t idleUs = 0)
+{
+    Mark end = Mark::now();
+    double tx = (double)(end.bus.writes - start.bus.writes + end.bus.reads - start.bus.reads) / readings;
+    double bytes = (double)(end.bus.bytes - start.bus.bytes) / readings;
+    double nacks = (double)(end.bus.nacks - start.bus.nacks) / readings;
+    double simUs = (double)(end.simUs - start.simUs - idleUs) / readings;
+    double ns = (double)(end.ns - start.ns) / readings;
+    printf("%-44s %8.1f %8.1f %8.1f %12.0f %10.0f\n", name, tx, bytes, nacks, simUs, ns);
+    if (strstr(name, "FAILED") != nullptr)
+        failures++;
+}
+
+// One legacy board: ADS1115 at adcAddr, LMP91000 at 0x48 behind MENB
+struct LegacyBoard
+{
+    SimADS1115 ads;
+    SimLMP91000 lmp;
+    LegacyBoard(uint8_t adcAddr, int menbPin) : ads(&analog), lmp(menbPin)
+    {
+        ads.frontEnd[0] = &lmp;
+        Wire.bus->attach(adcAddr, &ads);
+        Wire.bus->attach(LMP91000_I2C_ADDRESS, &lmp);
+    }
+};
+
+struct BridgeBoard
+{
+    SimBridge bridge;
+    BridgeBoard(uint8_t addr) : bridge(&analog)
+    {
+        Wire.bus->attach(addr, &bridge);
+    }
+};
+
+static void benchSingle(const char *name, const sensorType &type, uint8_t addr, uint8_t dataRate,
+                        bool legacyFirmware = false)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+    bridgeBoard.bridge.legacyFirmware = legacyFirmware;
+
+    char label[64];
+    ElectrochemicalGasSensor sensor(type, addr);
+    sensor.setDataRate(dataRate);
+
+    Mark start = Mark::now();
+    bool ok = sensor.begin();
+    snprintf(label, sizeof(label), "%s begin()%s", name, ok ? "" : " FAILED");
+    report(label, start, 1);
+
+    const uint32_t n = 20;
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+        sensor.getPPM();
+    snprintf(label, sizeof(label), "%s getPPM()", name);
+    report(label, start, n);
+
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        sensor.requestMeasurement();
+        sensor.readPPM();
+    }
+    snprintf(label, sizeof(label), "%s request+readPPM()", name);
+    report(label, start, n);
+}
+
+static void benchArray()
+{
+    Wire.bus->detachAll();
+
+    // 3 legacy boards share the LMP address (0x48), each behind its own MENB pin
+    LegacyBoard l0(0x49, 10), l1(0x4A, 11), l2(0x4B, 12);
+    BridgeBoard b0(0x30), b1(0x31), b2(0x32), b3(0x33), b4(0x34);
+
+    ElectrochemicalGasSensor sensors[8] = {
+        ElectrochemicalGasSensor(SENSOR_CO, 0x49, 10), ElectrochemicalGasSensor(SENSOR_NO2, 0x4A, 11),
+        ElectrochemicalGasSensor(SENSOR_SO2, 0x4B, 12), ElectrochemicalGasSensor(SENSOR_O3, 0x30),
+        ElectrochemicalGasSensor(SENSOR_H2S, 0x31),     ElectrochemicalGasSensor(SENSOR_NH3, 0x32),
+        ElectrochemicalGasSensor(SENSOR_CL2, 0x33),     ElectrochemicalGasSensor(SENSOR_NO, 0x34),
+    };
+
+    GasSensorArray array;
+    for (uint8_t i = 0; i < 8; i++)
+        array.add(sensors[i]);
+
+    Mark start = Mark::now();
+    bool ok = array.begin();
+    report(ok ? "8 mixed boards begin()" : "8 mixed boards begin() FAILED", start, 1);
+
+    const uint32_t n = 5;
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        for (uint8_t s = 0; s < 8; s++)
+            sensors[s].getPPM();
+    }
+    report("8 mixed boards, getPPM() one by one", start, n);
+
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+        array.scan();
+    report("8 mixed boards, GasSensorArray::scan()", start, n);
+}
+
+// Boards with the same config share the LMP91000 writes when started through a GasSensorArray
+static void benchSharedConfig()
+{
+    Wire.bus->detachAll();
+    LegacyBoard l0(0x49, 10), l1(0x4A, 11), l2(0x4B, 12);
+
+    ElectrochemicalGasSensor sensors[3] = {
+        ElectrochemicalGasSensor(SENSOR_CO, 0x49, 10),
+        ElectrochemicalGasSensor(SENSOR_CO, 0x4A, 11),
+        ElectrochemicalGasSensor(SENSOR_CO, 0x4B, 12),
+    };
+
+    Mark start = Mark::now();
+    bool ok = true;
+    for (uint8_t i = 0; i < 3; i++)
+        ok &= sensors[i].begin();
+    report(ok ? "3 legacy CO boards, begin() one by one" : "3 legacy CO boards, begin() one by one FAILED", start,
+           1);
+
+    Wire.bus->detachAll();
+    LegacyBoard m0(0x49, 10), m1(0x4A, 11), m2(0x4B, 12);
+    ElectrochemicalGasSensor fresh[3] = {
+        ElectrochemicalGasSensor(SENSOR_CO, 0x49, 10),
+        ElectrochemicalGasSensor(SENSOR_CO, 0x4A, 11),
+        ElectrochemicalGasSensor(SENSOR_CO, 0x4B, 12),
+    };
+    GasSensorArray array;
+    for (uint8_t i = 0; i < 3; i++)
+        array.add(fresh[i]);
+
+    start = Mark::now();
+    ok = array.begin();
+    // Every board has to end up with the config, not only the first one of the group
+    ok &= m0.lmp.regs[0x10] == lmpTiacn(SENSOR_CO) && m1.lmp.regs[0x10] == lmpTiacn(SENSOR_CO) &&
+          m2.lmp.regs[0x10] == lmpTiacn(SENSOR_CO) && m2.lmp.regs[0x12] == lmpModecn(SENSOR_CO);
+    report(ok ? "3 legacy CO boards, GasSensorArray::begin()" : "3 legacy CO boards, GasSensorArray::begin() FAILED",
+           start, 1);
+
+    // Again, the drivers know the boards have the config, so there's nothing to write
+    start = Mark::now();
+    ok = array.begin();
+    report(ok ? "3 legacy CO boards, begin() again" : "3 legacy CO boards, begin() again FAILED", start, 1);
+}
+
+// begin() after a reset of the MCU only, the boards kept their config
+static void benchWarmStart(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+    char label[64];
+
+    ElectrochemicalGasSensor cold(SENSOR_CO, addr);
+    cold.setWarmStart(true);
+    Mark start = Mark::now();
+    bool ok = cold.begin() && !cold.isWarmStarted();
+    snprintf(label, sizeof(label), "%s cold begin(), warm start on%s", name, ok ? "" : " FAILED");
+    report(label, start, 1);
+
+    ElectrochemicalGasSensor warm(SENSOR_CO, addr);
+    warm.setWarmStart(true);
+    start = Mark::now();
+    ok = warm.begin() && warm.isWarmStarted();
+    snprintf(label, sizeof(label), "%s warm begin()%s", name, ok ? "" : " FAILED");
+    report(label, start, 1);
+}
+
+// Sensitivity up 20% at 40 degrees, no zero drift
+static const float benchSensitivity[] = {0.8F, 1.0F, 1.2F};
+static const temperatureCurve benchCurve = {0, 20, 3, benchSensitivity, nullptr};
+
+// One temperature reading per 10 gas readings, with the compensation
+static void benchTemperature(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+    char label[64];
+    simDieTemperatureC = 40.0;
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, addr);
+    sensor.setDataRate(7);
+    sensor.begin();
+    double plain = sensor.getPPM();
+
+    Mark start = Mark::now();
+    bool ok = sensor.measureTemperature() && fabs(sensor.getTemperature() - 40.0) < 0.5;
+    snprintf(label, sizeof(label), "%s measureTemperature()%s", name, ok ? "" : " FAILED");
+    report(label, start, 1);
+
+    sensor.setTemperatureCurve(&benchCurve);
+    sensor.setTemperatureInterval(10);
+    const uint32_t n = 100;
+    double sum = 0;
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+        sum += sensor.getPPM();
+    // The LMP91000 has to be back in the gas mode after each temperature reading
+    ok = fabs(sum / n - plain / 1.2) < 0.05 * plain;
+    snprintf(label, sizeof(label), "%s getPPM(), 1 temperature per 10%s", name, ok ? "" : " FAILED");
+    report(label, start, n);
+
+    // The non-blocking path mustn't wait for the temperature settling
+    sensor.setTemperatureInterval(1);
+    start = Mark::now();
+    unsigned long startUs = micros();
+    ok = sensor.requestMeasurement();
+    ok = ok && micros() - startUs < TEMPERATURE_SETTLING_MS * 1000UL;
+    while (!sensor.isMeasurementReady())
+        ;
+    ok = sensor.readPPM() >= 0 && ok;
+    snprintf(label, sizeof(label), "%s requestMeasurement() with temperature%s", name, ok ? "" : " FAILED");
+    report(label, start, 1);
+
+    simDieTemperatureC = 25.0;
+}
+
+// CO cell going from 1 ppm to 200 ppm and back, with a reading every 100 ms
+static void benchAutoRange(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+    SimCell cell = {0, 0.0002, 0};
+    legacy.ads.cell[0] = &cell;
+    bridgeBoard.bridge.cell = &cell;
+    char label[80];
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, addr);
+    sensor.setDataRate(7);
+    sensor.begin();
+    sensor.setAutoRange(AUTORANGE_PGA_TIA);
+
+    const double steps[] = {1.0, 200.0, 1.0};
+    for (int s = 0; s < 3; s++)
+    {
+        cell.nanoAmps = steps[s] * SENSOR_CO.nanoAmperesPerPPM;
+        const uint32_t n = 100;
+        double ppm = 0;
+        Mark start = Mark::now();
+        for (uint32_t i = 0; i < n; i++)
+        {
+            ppm = sensor.getPPM();
+            simAdvanceUs(100000);
+        }
+        // What one ADC code is worth in the range it ended up in
+        double ppmPerCode = sensor.rawToPPM(20000) - sensor.rawToPPM(19999);
+        bool ok = fabs(ppm - steps[s]) < 0.02 * steps[s] + 0.05;
+        snprintf(label, sizeof(label), "%s auto-range %.0f ppm: %.4f ppm/code%s", name, steps[s], ppmPerCode,
+                 ok ? "" : " FAILED");
+        report(label, start, n, n * 100000ULL);
+    }
+}
+
+// CO cell on a 100k external TIA resistor, only the PGA can range, from 1 to 100 ppm and back
+static void benchAutoRangeExternal(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+    SimCell cell = {0, 0.0002, 100000};
+    legacy.ads.cell[0] = &cell;
+    bridgeBoard.bridge.cell = &cell;
+    char label[80];
+
+    sensorType external = SENSOR_CO;
+    external.TIA_GAIN_IN_KOHMS = TIA_GAIN_EXTERNAL;
+    ElectrochemicalGasSensor sensor(external, addr);
+    sensor.setDataRate(7);
+    sensor.begin();
+    sensor.setCustomTiaGain(100000);
+    sensor.setAutoRange(AUTORANGE_PGA);
+
+    const double steps[] = {1.0, 100.0, 1.0};
+    for (int s = 0; s < 3; s++)
+    {
+        cell.nanoAmps = steps[s] * SENSOR_CO.nanoAmperesPerPPM;
+        const uint32_t n = 20;
+        double ppm = 0;
+        Mark start = Mark::now();
+        // The mean of the last half, once the range has settled, a single reading depends on the noise
+        for (uint32_t i = 0; i < n; i++)
+        {
+            double reading = sensor.getPPM();
+            if (i >= n / 2)
+                ppm += reading / (n / 2);
+        }
+        bool ok = fabs(ppm - steps[s]) < 0.02 * steps[s] + 0.05;
+        snprintf(label, sizeof(label), "%s ext. TIA, PGA range %.0f ppm: %.2f%s", name, steps[s], ppm,
+                 ok ? "" : " FAILED");
+        report(label, start, n);
+    }
+}
+
+// CO cell at 5 ppm, single-ended and against the internal zero on AIN1, with the 2.5V reference 1% low
+static void benchDifferential(bool differential)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    SimCell cell = {5 * SENSOR_CO.nanoAmperesPerPPM, 0.0002, 0};
+    legacy.ads.cell[0] = &cell;
+    legacy.ads.zeroOnAin1 = true;
+    char label[80];
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x49);
+    sensor.setDifferential(differential);
+    sensor.setDataRate(7);
+    sensor.begin();
+    sensor.setAutoRange(AUTORANGE_PGA);
+    for (int i = 0; i < 10; i++)
+        sensor.getPPM();
+
+    const double refs[] = {2.5, 2.475};
+    for (int r = 0; r < 2; r++)
+    {
+        simReferenceVolts = refs[r];
+        const uint32_t n = 20;
+        double sum = 0;
+        Mark start = Mark::now();
+        for (uint32_t i = 0; i < n; i++)
+            sum += sensor.getPPM();
+        // Only the differential reading has to ignore the drift
+        bool ok = !differential || fabs(sum / n - 5.0) < 0.1;
+        snprintf(label, sizeof(label), "%s, ref %.3fV: %.2f ppm%s", differential ? "differential" : "single-ended",
+                 refs[r], sum / n, ok ? "" : " FAILED");
+        report(label, start, n);
+    }
+    simReferenceVolts = 2.5;
+}
+
+// 4 CO cells on one ADS1115 at 5, 10, 15 and 20 ppm, each LMP91000 behind its own MENB pin.
+// The inputs keep 30% of the previous one in the first conversion after a mux switch.
+static void benchMultiCell(bool discard)
+{
+    Wire.bus->detachAll();
+    SimADS1115 ads(&analog);
+    SimLMP91000 lmps[4] = {SimLMP91000(20), SimLMP91000(21), SimLMP91000(22), SimLMP91000(23)};
+    SimCell cells[4];
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        cells[i].nanoAmps = 5 * (i + 1) * SENSOR_CO.nanoAmperesPerPPM;
+        cells[i].noiseVolts = 0;
+        cells[i].externalOhms = 0;
+        ads.frontEnd[i] = &lmps[i];
+        ads.cell[i] = &cells[i];
+        Wire.bus->attach(LMP91000_I2C_ADDRESS, &lmps[i]);
+    }
+    ads.switchCarryover = 0.3;
+    Wire.bus->attach(0x49, &ads);
+    char label[80];
+
+    // The cells point to the one on AIN0, so they can't be copied into an array
+    ElectrochemicalGasSensor c0(SENSOR_CO, 0x49, 20);
+    ElectrochemicalGasSensor c1(SENSOR_CO, c0, 1, 21);
+    ElectrochemicalGasSensor c2(SENSOR_CO, c0, 2, 22);
+    ElectrochemicalGasSensor c3(SENSOR_CO, c0, 3, 23);
+    ElectrochemicalGasSensor *cellSensors[4] = {&c0, &c1, &c2, &c3};
+
+    GasSensorArray array;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        cellSensors[i]->setDataRate(7);
+        cellSensors[i]->setDiscardAfterSwitch(discard);
+        array.add(*cellSensors[i]);
+    }
+
+    Mark start = Mark::now();
+    bool ok = array.begin();
+    for (uint8_t i = 0; i < 4; i++)
+        ok &= lmps[i].regs[0x10] == lmpTiacn(SENSOR_CO) && lmps[i].regs[0x12] == lmpModecn(SENSOR_CO);
+    if (!discard)
+        report(ok ? "4 cells on one ADS1115 begin()" : "4 cells on one ADS1115 begin() FAILED", start, 1);
+
+    const uint32_t n = 10;
+    double worst = 0;
+    start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        ok &= array.scan();
+        for (uint8_t c = 0; c < 4; c++)
+        {
+            double error = fabs(array.getPPM(c) - 5 * (c + 1));
+            if (error > worst)
+                worst = error;
+        }
+    }
+    snprintf(label, sizeof(label), "4 cells scan()%s, worst error %.2f ppm%s", discard ? "+discard" : "", worst,
+             ok ? "" : " FAILED");
+    report(label, start, n);
+
+    if (discard)
+        return;
+
+    // AIN0 is the owner's and there's no AIN4, cells on those don't start even with a working LMP91000
+    ElectrochemicalGasSensor onOwner(SENSOR_CO, c0, 0, 22);
+    ElectrochemicalGasSensor pastEnd(SENSOR_CO, c0, 4, 23);
+    start = Mark::now();
+    ok = !onOwner.begin() && !pastEnd.begin();
+    report(ok ? "cells on channel 0 and 4 begin() fail" : "cells on channel 0 and 4 begin() FAILED", start, 1);
+}
+
+static void benchStreaming(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, addr);
+    sensor.begin();
+
+    char label[64];
+    if (!sensor.startStreaming(7))
+    {
+        snprintf(label, sizeof(label), "%s streaming FAILED", name);
+        report(label, Mark::now(), 1);
+        return;
+    }
+
+    // Run for one simulated second, draining the buffer as we go
+    Mark start = Mark::now();
+    uint32_t samples = 0;
+    int16_t buf[16];
+    while (simNowUs() - start.simUs < 1000000)
+    {
+        sensor.updateStreaming();
+        samples += sensor.readSamples(buf, 16);
+        delayMicroseconds(100);
+    }
+    snprintf(label, sizeof(label), "%s streaming 860 SPS (%u samples)", name, samples);
+    report(label, start, samples ? samples : 1);
+
+    // The single-shot data rate has to be back afterwards, on the bridge as well
+    start = Mark::now();
+    sensor.stopStreaming();
+    bool restored = sensor.getDataRate() == 0 && (addr != 0x30 || bridgeBoard.bridge.dataRate == 0);
+    snprintf(label, sizeof(label), "%s stopStreaming()%s", name, restored ? "" : " FAILED");
+    report(label, start, 1);
+}
+
+// A bridge which answers 20ms later than expected, the split-phase polls should back off like getPPM()'s
+static void benchSlowBridge()
+{
+    Wire.bus->detachAll();
+    BridgeBoard bridgeBoard(0x30);
+    char label[64];
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x30);
+    sensor.setDataRate(7);
+    sensor.begin();
+    bridgeBoard.bridge.registerLatencyUs = 20000;
+
+    const uint32_t n = 10;
+    Mark start = Mark::now();
+    for (uint32_t i = 0; i < n; i++)
+        sensor.getPPM();
+    report("slow bridge getPPM()", start, n);
+
+    sensor.resetBridgeStats();
+    start = Mark::now();
+    bool ok = true;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        sensor.requestMeasurement();
+        ok &= sensor.readPPM() >= 0;
+    }
+    BridgeStats stats = sensor.getBridgeStats();
+    snprintf(label, sizeof(label), "slow bridge request+readPPM()%s", ok ? "" : " FAILED");
+    report(label, start, n);
+    printf("  bridge stats: %u transactions, %u polls, %u timeouts\n", stats.transactions, stats.polls,
+           stats.timeouts);
+}
+
+// The window comparator on a CO cell, ALERT/RDY on pin 30
+static void benchAlarm()
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    SimCell cell = {5 * SENSOR_CO.nanoAmperesPerPPM, 0.0002, 0};
+    legacy.ads.cell[0] = &cell;
+    legacy.ads.alertPin = 30;
+    pinMode(30, INPUT_PULLUP);
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x49);
+    sensor.setDataRate(4);
+    sensor.begin();
+
+    Mark start = Mark::now();
+    bool ok = sensor.setAlarmThresholdsPPM(1, 35, 2);
+    delay(200);
+    bool quiet = digitalRead(30) == HIGH;
+
+    // Over the high threshold, it latches and stays latched while it's out of range
+    cell.nanoAmps = 100 * SENSOR_CO.nanoAmperesPerPPM;
+    delay(200);
+    bool alarm = digitalRead(30) == LOW;
+    double ppm = sensor.clearAlarm();
+    delay(200);
+    bool relatched = digitalRead(30) == LOW;
+
+    // Back in range, clearing it releases the pin for good
+    cell.nanoAmps = 5 * SENSOR_CO.nanoAmperesPerPPM;
+    delay(200);
+    sensor.clearAlarm();
+    delay(200);
+    bool released = digitalRead(30) == HIGH;
+    sensor.disableAlarm();
+
+    ok &= quiet && alarm && fabs(ppm - 100) < 2 && relatched && released;
+    report(ok ? "legacy hardware alarm 1-35 ppm" : "legacy hardware alarm 1-35 ppm FAILED", start, 1, 1000000);
+
+    // High-only, clean air with its noise around 0 ppm mustn't trigger it
+    cell.nanoAmps = 0;
+    start = Mark::now();
+    ok = sensor.setAlarmThresholdsPPM(0, 35, 1);
+    delay(1000);
+    quiet = digitalRead(30) == HIGH;
+    cell.nanoAmps = 100 * SENSOR_CO.nanoAmperesPerPPM;
+    delay(200);
+    alarm = digitalRead(30) == LOW;
+    sensor.disableAlarm();
+
+    ok &= quiet && alarm;
+    report(ok ? "legacy hardware alarm, high only 35 ppm" : "legacy hardware alarm, high only FAILED", start, 1,
+           1200000);
+}
+
+// Streaming driven by the ALERT/RDY interrupt at 860 SPS, one sample per pulse
+static void benchInterruptStreaming()
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    legacy.ads.alertPin = 31;
+    char label[64];
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x49);
+    sensor.begin();
+    bool ok = sensor.startInterruptStreaming(31, 7);
+
+    Mark start = Mark::now();
+    uint32_t samples = 0;
+    int16_t buf[16];
+    while (ok && simNowUs() - start.simUs < 1000000)
+    {
+        sensor.updateStreaming();
+        samples += sensor.readSamples(buf, 16);
+        delayMicroseconds(100);
+    }
+    sensor.stopStreaming();
+
+    // Every conversion read once, and the pulses stop with the streaming
+    uint32_t conversions = legacy.ads.conversions;
+    delay(100);
+    ok &= samples >= 850 && sensor.getStreamOverruns() == 0 && legacy.ads.conversions == conversions;
+    snprintf(label, sizeof(label), "legacy ALERT/RDY streaming (%u samples)%s", samples, ok ? "" : " FAILED");
+    report(label, start, samples ? samples : 1);
+}
+
+// The filter stages on known input, no bus traffic
+static void benchFilter()
+{
+    Mark start = Mark::now();
+    bool ok = true;
+
+    // A single spike doesn't get through a median of 3
+    GasSampleFilter median;
+    median.setMedian(3);
+    const int16_t spiky[] = {100, 100, 5000, 100, 100};
+    for (uint8_t i = 0; i < 5; i++)
+        ok &= median.push(spiky[i]) && median.getValue() == 100;
+
+    // One output per 4 samples, their average
+    GasSampleFilter boxcar;
+    boxcar.setDecimation(4);
+    uint8_t outputs = 0;
+    for (int16_t i = 1; i <= 8; i++)
+    {
+        if (boxcar.push(i))
+        {
+            outputs++;
+            ok &= boxcar.getValue() == (outputs == 1 ? 2.5F : 6.5F);
+        }
+    }
+    ok &= outputs == 2;
+
+    // The EMA starts at the first sample and moves halfway each time
+    GasSampleFilter ema;
+    ema.setEMA(0.5F);
+    const float expected[] = {0, 50, 75};
+    const int16_t step[] = {0, 100, 100};
+    for (uint8_t i = 0; i < 3; i++)
+        ok &= ema.push(step[i]) && ema.getValue() == expected[i];
+
+    // An even size is rounded up within the window buffer
+    GasSampleFilter widest;
+    widest.setMedian(FILTER_MAX_MEDIAN + 1);
+    for (uint8_t i = 0; i < 2 * FILTER_MAX_MEDIAN; i++)
+        widest.push(i & 1 ? 1000 : 0);
+    ok &= widest.getValue() == 0 || widest.getValue() == 1000;
+
+    report(ok ? "GasSampleFilter median/decimation/EMA" : "GasSampleFilter median/decimation/EMA FAILED", start, 1);
+}
+
+// A legacy board unplugged after begin(), the split-phase reading has to fail instead of waiting forever
+static void benchUnplugged()
+{
+    Wire.bus->detachAll();
+    LegacyBoard *legacy = new LegacyBoard(0x49, -1);
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x49);
+    sensor.begin();
+    Wire.bus->detachAll();
+    delete legacy;
+
+    Mark start = Mark::now();
+    bool ok = sensor.requestMeasurement();
+    uint32_t polls = 0;
+    while (!sensor.isMeasurementReady() && polls < 1000000)
+        polls++;
+    ok = polls < 1000000 && sensor.readPPM() == -1;
+    report(ok ? "unplugged legacy board request+readPPM()" : "unplugged legacy board request+readPPM() FAILED", start,
+           1);
+
+    // The non-blocking averaging has to finish as well, with every measurement failed
+    start = Mark::now();
+    sensor.startAveraging(3, 100);
+    polls = 0;
+    while (!sensor.poll() && polls < 1000000)
+        polls++;
+    ok = sensor.isAveragingDone() && sensor.getAverageResult() == -1;
+    report(ok ? "unplugged legacy board 3 x poll() averaging" : "unplugged legacy board averaging FAILED", start, 3);
+
+    // A scan has to finish too, with the board which is still there read normally
+    BridgeBoard bridgeBoard(0x30);
+    ElectrochemicalGasSensor live(SENSOR_CO, 0x30);
+    live.begin();
+    GasSensorArray array;
+    array.add(sensor);
+    array.add(live);
+    start = Mark::now();
+    ok = !array.scan() && array.getPPM(0) == -1 && array.getPPM(1) >= 0;
+    report(ok ? "unplugged legacy board in scan()" : "unplugged legacy board in scan() FAILED", start, 1);
+}
+
+static void benchTimeout()
+{
+    Wire.bus->detachAll();
+    BridgeBoard bridgeBoard(0x30);
+    bridgeBoard.bridge.unresponsive = true;
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, 0x30);
+    Mark start = Mark::now();
+    bool ok = sensor.begin();
+    report(ok ? "unresponsive bridge begin() FAILED" : "unresponsive bridge begin() (times out)", start, 1);
+
+    // The non-blocking averaging has to finish anyway, with every measurement failed
+    start = Mark::now();
+    sensor.startAveraging(3, 100);
+    // Each measurement has to run into BRIDGE_TIMEOUT_MS
+    unsigned long startMs = millis();
+    while (!sensor.poll() && millis() - startMs < 4 * BRIDGE_TIMEOUT_MS)
+        ;
+    ok = sensor.isAveragingDone() && sensor.getAverageResult() == -1;
+    report(ok ? "unresponsive bridge 3 x poll() averaging" : "unresponsive bridge averaging FAILED", start, 3);
+
+    // Nothing at the address NACKs the command, that fails right away instead of polling to the timeout
+    ElectrochemicalGasSensor absent(SENSOR_CO, 0x31);
+    start = Mark::now();
+    unsigned long startUs = micros();
+    ok = !absent.begin() && micros() - startUs < BRIDGE_TIMEOUT_MS * 1000UL;
+    report(ok ? "absent bridge begin()" : "absent bridge begin() FAILED", start, 1);
+}
+
+// A second begin() mustn't lose the resistor of an external TIA gain, and end() lets go of the config pin
+static void benchReinit()
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, 10);
+    SimCell cell = {20 * SENSOR_CO.nanoAmperesPerPPM, 0, 100000};
+    legacy.ads.cell[0] = &cell;
+
+    sensorType external = SENSOR_CO;
+    external.TIA_GAIN_IN_KOHMS = TIA_GAIN_EXTERNAL;
+    ElectrochemicalGasSensor sensor(external, 0x49, 10);
+    sensor.setDataRate(7);
+    sensor.begin();
+    sensor.setCustomTiaGain(100000);
+
+    Mark start = Mark::now();
+    bool ok = sensor.begin() && fabs(sensor.getPPM() - 20) < 0.5;
+    sensor.end();
+    ok = ok && simPinMode(10) == INPUT;
+    report(ok ? "legacy ext. TIA begin() again, end()" : "legacy ext. TIA begin() again, end() FAILED", start, 1);
+}
+
+// CPU cost of the conversion alone, no bus traffic
+static void benchConversion()
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    ElectrochemicalGasSensor sensor(SENSOR_O3, 0x49);
+    sensor.begin();
+
+    const int n = 1000000;
+    volatile double sinkD = 0;
+    volatile int32_t sinkI = 0;
+
+    uint64_t start = hostCycles();
+    for (int i = 0; i < n; i++)
+        sinkD = sinkD + sensor.rawToPPM((int16_t)(i & 0x7FFF));
+    uint64_t ppmCycles = hostCycles() - start;
+
+    start = hostCycles();
+    for (int i = 0; i < n; i++)
+        sinkI = sinkI + sensor.getRawScaled((int16_t)(i & 0x7FFF));
+    uint64_t intCycles = hostCycles() - start;
+
+    // The compiled config has to give the same readings as the runtime one
+    ElectrochemicalGasSensorT<SENSOR_O3> compiled(0x49);
+    compiled.begin();
+    bool same = true;
+    for (int32_t raw = 0; raw < 32768; raw += 97)
+        same = same && fabs(compiled.rawToPPM((int16_t)raw) - sensor.rawToPPM((int16_t)raw)) < 1e-6;
+
+#ifdef HAVE_RDTSC
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("\n%-44s %10s\n", "conversion (host CPU per sample)", unit);
+    printf("%-44s %10.2f\n", "rawToPPM() double slope/offset", (double)ppmCycles / n);
+    printf("%-44s %10.2f\n", "getRawScaled() fixed-point", (double)intCycles / n);
+    if (!same)
+    {
+        printf("ElectrochemicalGasSensorT::rawToPPM() FAILED\n");
+        failures++;
+    }
+}
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+// The library's own counters have to agree with what the simulated bus saw
+static void benchStats(const char *name, uint8_t addr)
+{
+    Wire.bus->detachAll();
+    LegacyBoard legacy(0x49, -1);
+    BridgeBoard bridgeBoard(0x30);
+
+    ElectrochemicalGasSensor sensor(SENSOR_CO, addr);
+    sensor.setDataRate(7);
+    Mark start = Mark::now();
+    sensor.begin();
+    for (int i = 0; i < 10; i++)
+        sensor.getPPM();
+    Mark end = Mark::now();
+
+    SensorStats stats = sensor.getStats();
+    uint32_t writes = end.bus.writes - start.bus.writes;
+    uint32_t reads = end.bus.reads - start.bus.reads;
+    // The simulator also counts the address byte of every transaction
+    uint32_t bytes = end.bus.bytes - start.bus.bytes - writes - reads;
+    uint32_t nacks = end.bus.nacks - start.bus.nacks;
+    bool ok = stats.i2c.writes == writes && stats.i2c.reads == reads && stats.i2c.bytes == bytes && stats.i2c.nacks == nacks;
+    printf("%-14s writes %u/%u reads %u/%u bytes %u/%u nacks %u/%u busy %u timeouts %u%s\n", name, stats.i2c.writes,
+           writes, stats.i2c.reads, reads, stats.i2c.bytes, bytes, stats.i2c.nacks, nacks, stats.bridgeBusyRetries,
+           stats.bridgeTimeouts, ok ? "" : " FAILED");
+    if (!ok)
+        failures++;
+
+    const LatencyStats *ops[] = {&stats.configureLMP, &stats.measurement, &stats.temperature,
+                                 &stats.bridgeTransaction};
+    const char *names[] = {"configureLMP", "measurement", "temperature", "bridgeTransaction"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (ops[i]->count)
+            printf("  %-18s n %3u  min %6u  avg %6u  max %6u us\n", names[i], ops[i]->count, ops[i]->minUs,
+                   ops[i]->totalUs / ops[i]->count, ops[i]->maxUs);
+    }
+}
+#endif
+
+int main()
+{
+    printf("Simulated I2C at %u Hz\n\n", (unsigned)Wire.bus->clockHz);
+    printHeader();
+    benchSingle("legacy 8 SPS", SENSOR_CO, 0x49, 0);
+    benchSingle("legacy 860 SPS", SENSOR_CO, 0x49, 7);
+    benchSingle("bridge 8 SPS", SENSOR_CO, 0x30, 0);
+    benchSingle("bridge 860 SPS", SENSOR_CO, 0x30, 7);
+    benchSingle("bridge old firmware 8 SPS", SENSOR_CO, 0x30, 0, true);
+    benchArray();
+    benchSharedConfig();
+    benchWarmStart("legacy", 0x49);
+    benchWarmStart("bridge", 0x30);
+    benchTemperature("legacy", 0x49);
+    benchTemperature("bridge", 0x30);
+    benchAutoRange("legacy", 0x49);
+    benchAutoRange("bridge", 0x30);
+    benchAutoRangeExternal("legacy", 0x49);
+    benchAutoRangeExternal("bridge", 0x30);
+    benchDifferential(false);
+    benchDifferential(true);
+    benchMultiCell(false);
+    benchMultiCell(true);
+    benchStreaming("legacy", 0x49);
+    benchStreaming("bridge", 0x30);
+    benchSlowBridge();
+    benchAlarm();
+    benchInterruptStreaming();
+    benchFilter();
+    benchUnplugged();
+    benchTimeout();
+    benchReinit();
+    benchConversion();
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    printf("\nlibrary counters / simulated bus, begin() + 10 x getPPM() at 860 SPS\n");
+    benchStats("legacy", 0x49);
+    benchStats("bridge", 0x30);
+#endif
+
+    if (failures != 0)
+    {
+        printf("\n%u checks FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,14 @@
  ***************************************************/
 
 #include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "GasSampleFilter.h"
+
+// ISRs have to be placed in IRAM on ESP boards
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+ElectrochemicalGasSensor *ElectrochemicalGasSensor::rdyInstances[RDY_MAX_SENSORS] = {nullptr};
 
 /**
  * @brief                   Constructor on custom address
@@ -20,25 +28,151 @@
  *                          ATtiny bridge board: the bridge's easyC address (0x30-0x37).
  *                          begin() picks the transport based on which range this falls in.
  *
+ * @param int _configPin    GPIO connected to LMPEN on legacy boards, -1 if it's tied to GND
+ *
+ * @param TwoWire *_wire    The I2C bus the board is on, e.g. &Wire1 to spread boards over multiple buses
+ *
  */
-ElectrochemicalGasSensor::ElectrochemicalGasSensor(sensorType _t, uint8_t _adcAddr, int _configPin)
+ElectrochemicalGasSensor::ElectrochemicalGasSensor(sensorType _t, uint8_t _adcAddr, int _configPin, TwoWire *_wire)
+    : lmpDevice(_wire), adsDevice(_adcAddr, _wire)
 {
+    wire = _wire;
     adcAddr = _adcAddr;
     type = _t;
     configPin = _configPin;
+    compiled = nullptr;
+    customTiaGain = -1;
+    lmp = nullptr;
+    ads = nullptr;
     mode = TransportMode::LEGACY_DIRECT; // safe default until begin() determines the real mode
+    differential = false;
+    adcOwner = nullptr;
+    channel = 0;
+    adsShared = false;
+    adsMux = ADS_MUX_UNKNOWN;
+    discardAfterSwitch = false;
+
+    avgRunning = false;
+    avgTarget = 0;
+    avgCount = 0;
+    avgAttempts = 0;
+    avgSum = 0;
+    avgIntervalMs = 0;
+    avgLastSampleMs = 0;
+    avgStarted = false;
+    avgWaitingForResult = false;
+
+    measurementPending = false;
+    measurementFailed = false;
+    measurementDiscard = false;
+    measurementRaw = 0;
+    measurementStartUs = 0;
+    measurementNextPollUs = 0;
+
+    dataRate = 0; // slowest for more precision
+
+    warmStart = false;
+    warmStarted = false;
+    bridgeConfigured = false;
+    configurePending = false;
+
+    streaming = false;
+    streamDataRateBefore = dataRate;
+    streamPeriodUs = 0;
+    streamLastUs = 0;
+    streamHead = 0;
+    streamTail = 0;
+    streamOverruns = 0;
+
+    alarmEnabled = false;
+
+    ppmSlope = 0;
+    ppmOffset = 0;
+    fixedScale = 0;
+    fixedOffset = 0;
+    fixedShift = 0;
+
+    tempCurve = nullptr;
+    temperatureC = TEMPERATURE_INVALID;
+    temperatureInterval = 0;
+    temperatureCountdown = 0;
+    compSensitivity = 1;
+    compZeroPpm = 0;
+
+    autoRange = AUTORANGE_OFF;
+    rangeAdsGain = type.adsGain;
+    rangeTiaGain = type.TIA_GAIN_IN_KOHMS;
+    autoRangeSettling = false;
+    autoRangeChangeMs = 0;
+
+    bridgeLastStatus = BRIDGE_STATUS_NONE;
+    splitStartUs = 0;
+    splitNextPollUs = 0;
+    splitBackoffUs = BRIDGE_POLL_MIN_US;
+    resetBridgeStats();
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    resetStats();
+#endif
+
+    rdyPin = -1;
+    rdySlot = -1;
+    rdyPending = 0;
+}
+
+/**
+ * @brief                   Constructor for a cell on a multi-cell carrier board, which shares the ADS1115 of another
+ *
+ * @note                    The cells take turns on the ADS1115, a GasSensorArray with all of them schedules that.
+ *                          While they share it, none of them can stream or use the alarm.
+ *
+ * @param sensorType _t     The type of the sensor
+ *
+ * @param ElectrochemicalGasSensor &_adcOwner   The cell on AIN0, created with the ADS1115's address
+ *
+ * @param uint8_t _channel  The ADS1115 input this cell's VOUT is wired to, 1 to 3, begin() fails for any other
+ *
+ * @param int _configPin    GPIO connected to MENB of this cell's LMP91000, they're all at the same address
+ *
+ */
+ElectrochemicalGasSensor::ElectrochemicalGasSensor(sensorType _t, ElectrochemicalGasSensor &_adcOwner,
+                                                   uint8_t _channel, int _configPin)
+    : ElectrochemicalGasSensor(_t, _adcOwner.adcAddr, _configPin, _adcOwner.wire)
+{
+    adcOwner = &_adcOwner;
+    channel = _channel;
+    // An invalid channel never gets to use the ADS1115, so the owner keeps it to itself
+    if (channel >= 1 && channel <= 3)
+        _adcOwner.adsShared = true;
+}
+
+// Used by ElectrochemicalGasSensorT, see compiledSensorConfig
+ElectrochemicalGasSensor::ElectrochemicalGasSensor(const compiledSensorConfig &_compiled, sensorType _t,
+                                                   uint8_t _adcAddr, int _configPin, TwoWire *_wire)
+    : ElectrochemicalGasSensor(_t, _adcAddr, _configPin, _wire)
+{
+    compiled = &_compiled;
 }
 
 /**
  * @brief                   Init the sensor and begin measuring with the ADC, must be called before using
  *
+ * @param bool _configureLMP    False to skip the front end configuration, when an LMPConfigManager
+ *                              or requestConfigure() does it later
+ *
  * @returns                 True if it was successful, false if it failed
  *
  */
-bool ElectrochemicalGasSensor::begin()
+bool ElectrochemicalGasSensor::begin(bool _configureLMP)
 {
+    // Started already? Stop what's running in the background, the drivers keep what they know
+    if (ads != nullptr)
+    {
+        stopStreaming();
+        disableAlarm();
+    }
+
     // Init twoWire communication
-    Wire.begin();
+    wire->begin();
 
     // Decide which board revision we're talking to: ATtiny bridge boards use the
     // easyC jumper address range, legacy direct-wired boards use the ADS1115's own.
@@ -49,14 +183,27 @@ bool ElectrochemicalGasSensor::begin()
 
     if (mode == TransportMode::LEGACY_DIRECT)
     {
-        // Create objects in memory
-        lmp = new LMP91000();
-        ads = new ADS1115(adcAddr);
+        // AIN0 belongs to the owner and the ADS1115 has no input above AIN3
+        if (adcOwner != nullptr && (channel < 1 || channel > 3))
+            return false;
+
+        lmp = &lmpDevice;
+        ads = adcOwner != nullptr ? &adcOwner->adsDevice : &adsDevice;
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+        lmp->setCounters(&stats.i2c);
+        // The traffic of a shared ADS1115 is counted by the cell which owns it
+        if (adcOwner == nullptr)
+            ads->setCounters(&stats.i2c);
+#endif
 
         // Begin ADS
         result = ads->begin();
+        adcHost()->adsMux = ADS_MUX_UNKNOWN;
+        // AIN1 carries the owner's internal zero when it measures differentially
+        if (adcOwner != nullptr && adcOwner->differential && channel == 1)
+            result = false;
         ads->setGain(type.adsGain); // Set gain to the one which is in the config
-        ads->setDataRate(0);        // Set data rate to slowest for more precision
+        ads->setDataRate(dataRate); // Slowest by default for more precision, see setDataRate()
 
         // Begin the config pin if it's set
         if (configPin != -1)
@@ -69,23 +216,61 @@ bool ElectrochemicalGasSensor::begin()
     {
         // ads is only ever used here for its toVoltage()/getMaxVoltage() math - it
         // never issues any I2C traffic of its own in bridge mode.
-        ads = new ADS1115();
+        ads = &adsDevice;
         ads->setGain(type.adsGain);
-        ads->setDataRate(0);
+        ads->setDataRate(dataRate);
 
-        result = pingBridge();
-        result &= sendConfigureAdc(type.adsGain, 0);
+        // Nothing to send here, configureLMP() below sends the ADC and LMP config together
+        // in one CMD_CONFIGURE_ALL, which also tells us the bridge is there.
+        // The bridge only converts AIN0, so there's nothing to share on these boards.
+        result = adcOwner == nullptr;
         // configPin is unused here - LMPEN is hardwired to GND on the bridge board.
     }
 
     // Now, configure the LMP analog frontend as well:
-    result &= configureLMP();
+    if (_configureLMP)
+        result &= configureLMP();
+    else
+        loadConfig();
 
 
     // Will return 1 if both the transport-specific setup and configureLMP() were OK
     return result;
 }
 
+/**
+ * @brief                   Stop using the sensor and leave the I2C bus to others
+ *
+ * @note                    Stops streaming, the alarm and anything started with the split-phase functions.
+ *                          The LMP91000 keeps its config so the cell stays biased, see setWarmStart().
+ *                          The config pin goes back to an input. Wire itself isn't ended, other devices may
+ *                          still be using it.
+ *
+ */
+void ElectrochemicalGasSensor::end()
+{
+    if (ads == nullptr)
+        return;
+
+    stopStreaming();
+    disableAlarm();
+
+    measurementPending = false;
+    configurePending = false;
+    avgRunning = false;
+    bridgeConfigured = false;
+
+    // Leave the pin as it was before begin(), it's set up again there
+    if (configPin != -1)
+        pinMode(configPin, INPUT);
+
+    // Anything may talk to the devices until the next begin(), so the driver caches can't be trusted
+    lmpDevice.resync();
+    adsDevice.resync();
+    lmp = nullptr;
+    ads = nullptr;
+}
+
 /**
  * @brief                   Configure the LMP91000, has to be done at startup
  *
@@ -94,25 +279,15 @@ bool ElectrochemicalGasSensor::begin()
  */
 bool ElectrochemicalGasSensor::configureLMP()
 {
-    // Crate the values to write in the sensor to configure it
-    // tiacn register
-    uint8_t tiacn = 0x00;
-    tiacn |= (type.TIA_GAIN_IN_KOHMS << 2);
-    tiacn |= type.RLOAD;
-
-    // refcn register
-    uint8_t refcn = 0x00;
-    refcn |= (type.REF_SOURCE << 7);
-    refcn |= (type.INTERNAL_ZERO << 5);
-    refcn |= (type.BIAS_SIGN << 4);
-    refcn |= type.BIAS;
+    SENSOR_STATS_START();
 
-    // modecn register
-    uint8_t modecn = 0x00;
-    modecn |= (type.FET_SHORT << 7);
-    modecn |= type.OP_MODE;
+    // Crate the values to write in the sensor to configure it, see sensorConfigData.h
+    uint8_t tiacn = lmpTiacnValue();
+    uint8_t refcn = lmpRefcnValue();
+    uint8_t modecn = lmpModecnValue();
 
     uint8_t res;
+    warmStarted = false;
 
     if (mode == TransportMode::LEGACY_DIRECT)
     {
@@ -120,8 +295,16 @@ bool ElectrochemicalGasSensor::configureLMP()
         if (configPin != -1)
             digitalWrite(configPin, LOW);
 
-        // Configure it!
-        res = lmp->configure(tiacn, refcn, modecn);
+        // Configure it! After a warm start the LMP91000 may already have the config, then there's nothing to write
+        if (warmStart && !lmp->isConfigured() && lmp->verifyConfig(tiacn, refcn, modecn))
+        {
+            warmStarted = true;
+            res = 1;
+        }
+        else
+        {
+            res = lmp->configure(tiacn, refcn, modecn);
+        }
 
         // Disable config again
         if (configPin != -1)
@@ -129,297 +312,2036 @@ bool ElectrochemicalGasSensor::configureLMP()
     }
     else // TransportMode::BRIDGE - LMPEN is grounded on the board, nothing to toggle
     {
-        res = sendConfigureLmp(tiacn, refcn, modecn);
+        uint8_t flags = 0;
+        res = sendConfigureAll(type.adsGain, dataRate, tiacn, refcn, modecn, &flags);
+        warmStarted = res && flags == BRIDGE_CONFIG_UNCHANGED;
+
+        // Bridge firmware without CMD_CONFIGURE_ALL answers with an error, use the separate commands then
+        if (!res && bridgeLastStatus == BRIDGE_STATUS_ERROR)
+            res = pingBridge() && sendConfigureAdc(type.adsGain, dataRate) && sendConfigureLmp(tiacn, refcn, modecn);
+        bridgeConfigured = res;
     }
 
-    // Save key variables in the class as well so we don't have to keep getting them:
-    tiaGainInKOHms = getTiaGain();
-    internalZeroPercent = getInternalZeroPercent();
+    loadConfig();
+
+    SENSOR_STATS_RECORD(stats.configureLMP);
 
     // Notify the user if the configuration went well or not
     return res;
 }
 
 /**
- * @brief                   get the voltage which the ADS is currently measuring
+ * @brief                   Start configuring the front end without waiting for it, see configureLMP()
  *
- * @returns                 double value of the voltage in volts
+ * @note                    Only bridge boards are configured in the background, legacy boards are
+ *                          configured before this returns. Check on it with isConfigureDone().
+ *
+ * @returns                 True if the configuration was sent (legacy boards: done) successfully
  *
  */
-double ElectrochemicalGasSensor::getVoltage()
+bool ElectrochemicalGasSensor::requestConfigure()
 {
-    // Get raw reading and calculate voltage
-    int16_t rawReading;
+    configurePending = false;
+
     if (mode == TransportMode::LEGACY_DIRECT)
-        rawReading = ads->readADC(0);
-    else
-        triggerAndReadAdc(rawReading);
+        return configureLMP();
 
-    double voltage = ads->toVoltage(rawReading);
-    return voltage;
+    // TransportMode::BRIDGE - only send the command here, the response is polled in isConfigureDone()
+    warmStarted = false;
+    bridgeConfigured = false;
+    uint8_t payload[5] = {type.adsGain, dataRate, lmpTiacnValue(), lmpRefcnValue(), lmpModecnValue()};
+    configurePending = bridgeSendCommand(CMD_CONFIGURE_ALL, payload, 5);
+    if (configurePending)
+        bridgeSplitStart(CMD_CONFIGURE_ALL);
+    return configurePending;
 }
 
-
 /**
- * @brief                   Make a measurement with the ADC and calculate the PPM value of the measured gas
+ * @brief                   Check if the configuration started with requestConfigure() is done
  *
- * @returns                 double value of the PPM
+ * @note                    Doesn't wait, it checks the status once and returns.
+ *                          Also returns true if it failed, see isConfigured().
+ *
+ * @returns                 True if the configuration is done
  *
  */
-double ElectrochemicalGasSensor::getPPM()
+bool ElectrochemicalGasSensor::isConfigureDone()
 {
-    // Get the voltage from the ADS
-    double voltage = getVoltage();
-
-#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
-    Serial.println();
-    Serial.println("Electrochemical gas sensor readings:");
-    Serial.print("Raw voltage measurement: ");
-    Serial.print(voltage, 10);
-    Serial.println(" V");
-#endif
+    if (!configurePending)
+        return true;
 
-    // Calculate current and calculate PPM based on datasheet
-    double voltsNoRef = voltage - (REF_VOLTAGE * (internalZeroPercent / 100.0F));
-
-#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
-    Serial.print("Voltage without reference value: ");
-    Serial.print(voltsNoRef, 10);
-    Serial.println(" V");
-#endif
+    uint8_t hi = 0;
+    uint8_t status = bridgeSplitPoll(&hi, nullptr);
+    if (status == BRIDGE_STATUS_BUSY)
+        return false;
 
-    voltsNoRef += type.internalZeroCalibration; // Add the calibration value as well
+    if (status == BRIDGE_STATUS_OK)
+    {
+        bridgeConfigured = true;
+        warmStarted = hi == BRIDGE_CONFIG_UNCHANGED;
+    }
+    else if (status == BRIDGE_STATUS_ERROR)
+    {
+        // Firmware without CMD_CONFIGURE_ALL, fall back to the separate commands like configureLMP()
+        bridgeConfigured = pingBridge() && sendConfigureAdc(type.adsGain, dataRate) &&
+                           sendConfigureLmp(lmpTiacnValue(), lmpRefcnValue(), lmpModecnValue());
+    }
 
-#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
-    Serial.print("Voltage after calibration: ");
-    Serial.print(voltsNoRef, 10);
-    Serial.println(" V");
-    Serial.println("");
-#endif
+    configurePending = false;
+    loadConfig();
+    return true;
+}
 
-    double current = voltsNoRef / tiaGainInKOHms;
-    double ppm = current / (type.nanoAmperesPerPPM * (double)1e-9);
+/**
+ * @brief                   Check if the front end has been configured, without any I2C traffic
+ *
+ * @returns                 True if the last configuration was successful
+ *
+ */
+bool ElectrochemicalGasSensor::isConfigured()
+{
+    if (mode == TransportMode::BRIDGE)
+        return bridgeConfigured && !configurePending;
+    return lmp != nullptr && lmp->isConfigured();
+}
 
-    // Due to noise when making really small precise measurements (in ppb)
-    // ppm can sometimes go into negative due to noise - just round it to zero
-    if (ppm < 0)
-        ppm = 0;
-    return ppm;
+/**
+ * @brief                   Enable or disable the warm start check of legacy boards, disabled by default
+ *
+ * @note                    Costs about 4 more I2C transactions on a cold start and saves about 11 on a warm one.
+ *                          Call before begin().
+ *
+ * @param bool _warmStart   True to read the LMP91000 back before configuring it
+ *
+ */
+void ElectrochemicalGasSensor::setWarmStart(bool _warmStart)
+{
+    warmStart = _warmStart;
 }
 
 /**
- * @brief                   Calcualte PPB values from PPM
+ * @brief                   Check if the last configuration found the front end already configured
  *
- * @returns                 double value of PPB
+ * @note                    The cell was biased the whole time then and doesn't have to stabilize again
+ *
+ * @returns                 True if nothing had to be written
  *
  */
-double ElectrochemicalGasSensor::getPPB()
+bool ElectrochemicalGasSensor::isWarmStarted()
 {
-    return getPPM() * 1000.0;
+    return warmStarted;
 }
 
 /**
- * @brief                               Calculate an averaged PPM measurement from a number of separate measurements
+ * @brief                   Load the gains of the sensor config for the PPM conversion
  *
- * @note                                This is a blocking function, it won't exit until it's completed
+ */
+void ElectrochemicalGasSensor::loadConfig()
+{
+    // Save key variables in the class as well so we don't have to keep getting them:
+    tiaGainInKOHms = getTiaGain();
+    internalZeroPercent = getInternalZeroPercent();
+    updateConversion();
+}
+
+/**
+ * @brief                   get the voltage which the ADS is currently measuring
  *
- * @param uint8_t _numMeasurements     How many measurements to do
+ * @returns                 double value of the voltage in volts
  *
- * @param uint8_t _secondsDelay         How many seconds to wait between each measurement
+ */
+double ElectrochemicalGasSensor::getVoltage()
+{
+    // Get raw reading and calculate voltage
+    int16_t rawReading = getRaw();
+
+    double voltage = ads->toVoltage(rawReading);
+    return voltage;
+}
+
+/**
+ * @brief                   Make a measurement with the ADC and get the raw reading
  *
- * @returns                 double value of the calculated averaged PPM
+ * @returns                 Raw ADC reading
  *
  */
-double ElectrochemicalGasSensor::getAveragedPPM(uint8_t _numMeasurements, uint8_t _secondsDelay)
+int16_t ElectrochemicalGasSensor::getRaw()
 {
-    double totalMeasurements = 0;
+    autoRangeApply();
+    interleaveTemperature();
 
-    // Sum all the separate measurements
-    for (int i = 0; i < _numMeasurements; i++)
+    SENSOR_STATS_START();
+
+    int16_t rawReading;
+    bool ok = true;
+    if (mode == TransportMode::LEGACY_DIRECT)
     {
-        // Make the individual measurement
-        totalMeasurements += getPPM();
-        // Wait for the set number of seconds
-        delay(1000 * _secondsDelay);
+        // The first conversion after a mux switch may still see the previous input, see setDiscardAfterSwitch()
+        if (selectSignal() && discardAfterSwitch)
+            readSignal();
+        rawReading = readSignal();
     }
+    else
+        ok = triggerAndReadAdc(rawReading);
 
-    // Return the final value
-    return totalMeasurements / _numMeasurements;
+    if (ok)
+        autoRangeCheck(rawReading);
+
+    SENSOR_STATS_RECORD(stats.measurement);
+    return rawReading;
 }
 
 /**
- * @brief                               Calculate an averaged PPB measurement from a number of separate measurements
- *
- * @note                                This is a blocking function, it won't exit until it's completed
- *
- * @param uint8_t _numMeasurements     How many measurements to do
+ * @brief                   Make a measurement with the ADC and calculate the PPB value with integer math only
  *
- * @param uint8_t _secondsDelay         How many seconds to wait between each measurement
+ * @note                    Faster than getPPB() on MCUs without an FPU, e.g. AVR
  *
- * @returns                 double value of the calculated averaged PPB
+ * @returns                 PPB as a 32-bit integer
  *
  */
-double ElectrochemicalGasSensor::getAveragedPPB(uint8_t _numMeasurements, uint8_t _secondsDelay)
+int32_t ElectrochemicalGasSensor::getPPBInt()
 {
-    return getAveragedPPM(_numMeasurements, _secondsDelay) * 1000;
+    return getRawScaled(getRaw());
 }
 
 /**
- * @brief                              Get the actual number of the kOhms in the TIA gain
+ * @brief                   Calculate the PPB value from a raw ADC reading with integer math only
  *
- * @note                                Only used internally in the class
+ * @note                    Uses the scale and offset precomputed by updateConversion(), so it's
+ *                          a single multiply-add and a shift
  *
- * @returns                 float of the TIA gain depending on the config
+ * @param int16_t _raw      Raw reading, e.g. from readSamples()
+ *
+ * @returns                 PPB as a 32-bit integer, rounded to zero if negative like getPPM()
  *
  */
-float ElectrochemicalGasSensor::getTiaGain()
+int32_t ElectrochemicalGasSensor::getRawScaled(int16_t _raw)
 {
-    switch (type.TIA_GAIN_IN_KOHMS)
-    {
-    case TIA_GAIN_EXTERNAL:
-        // For this, use setCustomTiaGain
-        return -1;
-        break;
-    case TIA_GAIN_2_75_KOHM:
-        return 2750.00F;
-        break;
-    case TIA_GAIN_3_5_KOHM:
-        return 3500.00F;
-        break;
-    case TIA_GAIN_7_KOHM:
-        return 7000.00F;
-        break;
-    case TIA_GAIN_14_KOHM:
-        return 14000.00F;
-        break;
-    case TIA_GAIN_35_KOHM:
-        return 35000.00F;
-        break;
-    case TIA_GAIN_120_KOHM:
-        return 120000.00F;
-        break;
-    case TIA_GAIN_350_KOHM:
-        return 350000.00F;
-        break;
-    default:
-        return -1;
-        break;
-    }
+    int32_t scaled = (int32_t)_raw * fixedScale + fixedOffset;
+    if (scaled < 0)
+        return 0;
+    return scaled >> fixedShift;
 }
 
 /**
- * @brief           Set a custom number of the kOhms in the TIA gain
+ * @brief                   Make measurements and feed them through a filter until it has a new output sample
  *
- * @note            This is if you're using an external resistor
+ * @note                    This is a blocking function, it makes as many measurements as the filter's
+ *                          decimation is set to. Use a faster data rate with setDataRate() to keep it short.
  *
- * @returns         None
+ * @param GasSampleFilter &_filter  The filter to use, keeps its state between calls
+ *
+ * @returns                 double value of the filtered PPM
  *
  */
-void ElectrochemicalGasSensor::setCustomTiaGain(float _tiaGain)
+double ElectrochemicalGasSensor::getFilteredPPM(GasSampleFilter &_filter)
 {
-    tiaGainInKOHms = _tiaGain;
+    while (!_filter.push(getRaw()))
+        ;
+    return filteredRawToPPM(_filter.getValue());
 }
 
 /**
- * @brief           Get the internal zero % setting as an actual float
+ * @brief                   Calculate the PPM value from a filtered raw ADC reading
  *
- * @returns         The internal zero as a float
+ * @param float _raw        Raw reading with a fractional part, e.g. from GasSampleFilter::getValue()
+ *
+ * @returns                 double value of the PPM
  *
  */
-float ElectrochemicalGasSensor::getInternalZeroPercent()
+double ElectrochemicalGasSensor::filteredRawToPPM(float _raw)
 {
-    switch (type.INTERNAL_ZERO)
-    {
-    case INTERNAL_ZERO_20_PERCENT:
-        return 20.00F;
-        break;
-    case INTERNAL_ZERO_50_PERCENT:
-        return 50.00F;
-        break;
-    case INTERNAL_ZERO_67_PERCENT:
-        return 67.00F;
-        break;
-    case INTERNAL_ZERO_BYPASSED:
-        // This is not implemented, just the standard internal zero mode
-        return -1;
-        break;
-    default:
-        return -1;
-        break;
-    }
+    double ppm = _raw * ppmSlope + ppmOffset;
+
+    // Same as in rawToPPM(), filtering just makes this a lot less likely
+    if (ppm < 0)
+        ppm = 0;
+    return ppm;
 }
 
 /**
- * @brief                   Set a custom value for the zero calibration
+ * @brief                   Precompute the raw reading to PPM/PPB conversion used by rawToPPM() and getRawScaled()
  *
- * @param calibration       Voltage level at 0ppm
+ * @note                    Has to be called whenever the TIA gain, ADC gain or calibration changes
  *
  */
-void ElectrochemicalGasSensor::setCustomZeroCalibration(double calibration)
+void ElectrochemicalGasSensor::updateConversion()
 {
-    type.internalZeroCalibration=calibration;
+    if (ads == nullptr)
+        return;
+
+    if (compiled != nullptr)
+    {
+        ppmSlope = compiled->ppmSlope;
+        ppmOffset = compiled->ppmOffset;
+    }
+    else
+    {
+        // voltage = raw * lsb, the LSB has the same scale as ADS1X15::toVoltage()
+        // From the sensor's gain, a shared ADS1115 may have been left at another cell's
+        double lsb = adsMaxVoltageFromGain(type.adsGain) / 32767.0;
+
+        // ppm = (voltage - internal zero + calibration) / TIA gain / sensitivity,
+        // folded into ppm = raw * slope + offset
+        double voltsPerPPM = tiaGainInKOHms * (type.nanoAmperesPerPPM * (double)1e-9);
+        ppmSlope = lsb / voltsPerPPM;
+        // A differential reading is already relative to the internal zero, see setDifferential()
+        double zeroVolts = differential ? 0 : REF_VOLTAGE * (internalZeroPercent / 100.0F);
+        ppmOffset = (type.internalZeroCalibration - zeroVolts) / voltsPerPPM;
+    }
+
+    // Temperature compensation, ppm = (uncompensated ppm - zero at T) / sensitivity at T, see updateCompensation()
+    ppmSlope /= compSensitivity;
+    ppmOffset = (ppmOffset - compZeroPpm) / compSensitivity;
+
+    // The same transform in ppb, as fixed-point for getRawScaled()
+    double a = 1000.0 * ppmSlope;
+    double b = 1000.0 * ppmOffset;
+
+    // Use as many fractional bits as possible while raw * scale + offset still fits in 32 bits
+    double maxAbs = fabs(a) * 32768.0 + fabs(b) + 1.0;
+    fixedShift = 0;
+    while (fixedShift < 30 && maxAbs * (double)(1UL << (fixedShift + 1)) < 2147483647.0)
+        fixedShift++;
+
+    fixedScale = (int32_t)lround(a * (double)(1UL << fixedShift));
+    // Half an LSB is folded into the offset so the shift rounds instead of truncating
+    fixedOffset = (int32_t)lround((b + 0.5) * (double)(1UL << fixedShift));
 }
 
 /**
- * @brief                   Send a command to the ATtiny bridge and poll the 3-byte response
- *
- * @note                    Blocking - protocol is synchronous, one command in flight at a time.
- *                          Only used when mode == TransportMode::BRIDGE.
- *
- * @returns                 True if the bridge answered OK before the timeout, false on error/timeout
+ * @brief                   Evaluate the temperature curve at the last temperature and update the conversion
  *
  */
-bool ElectrochemicalGasSensor::bridgeTransaction(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
-                                                  uint8_t *resultHigh, uint8_t *resultLow)
+void ElectrochemicalGasSensor::updateCompensation()
 {
-    Wire.beginTransmission(adcAddr);
-    Wire.write(cmd);
-    for (uint8_t i = 0; i < payloadLen; i++)
-        Wire.write(payload[i]);
-    Wire.endTransmission();
+    compSensitivity = 1;
+    compZeroPpm = 0;
 
-    unsigned long start = millis();
-    while (millis() - start < BRIDGE_TIMEOUT_MS)
+    if (tempCurve != nullptr && tempCurve->points != 0 && temperatureC != TEMPERATURE_INVALID)
     {
-        Wire.requestFrom(adcAddr, (uint8_t)3);
-        if (Wire.available() < 3)
-            continue;
-
-        uint8_t status = Wire.read();
-        uint8_t hi = Wire.read();
-        uint8_t lo = Wire.read();
-
-        if (status == BRIDGE_STATUS_OK)
+        // Find the segment the temperature is in, held at the first and last point
+        float pos = (temperatureC - tempCurve->firstC) / (tempCurve->stepC ? tempCurve->stepC : 1);
+        uint8_t last = tempCurve->points - 1;
+        uint8_t i = 0;
+        float frac = 0;
+        if (pos >= last)
+            i = last;
+        else if (pos > 0)
         {
-            if (resultHigh)
-                *resultHigh = hi;
-            if (resultLow)
-                *resultLow = lo;
-            return true;
+            i = (uint8_t)pos;
+            frac = pos - i;
         }
-        if (status == BRIDGE_STATUS_ERROR)
-            return false;
+        uint8_t next = i < last ? i + 1 : i;
 
-        delay(5); // still BUSY or no command registered yet - retry
+        const float *s = tempCurve->sensitivity;
+        if (s != nullptr && s[i] + (s[next] - s[i]) * frac > 0)
+            compSensitivity = s[i] + (s[next] - s[i]) * frac;
+        const float *z = tempCurve->zeroPpm;
+        if (z != nullptr)
+            compZeroPpm = z[i] + (z[next] - z[i]) * frac;
     }
-    return false; // timeout
-}
 
-bool ElectrochemicalGasSensor::pingBridge()
-{
-    return bridgeTransaction(CMD_PING, nullptr, 0, nullptr, nullptr);
+    updateConversion();
 }
 
-bool ElectrochemicalGasSensor::sendConfigureAdc(uint8_t gain, uint8_t dataRate)
+
+/**
+ * @brief                   Make a measurement with the ADC and calculate the PPM value of the measured gas
+ *
+ * @returns                 double value of the PPM
+ *
+ */
+double ElectrochemicalGasSensor::getPPM()
 {
-    uint8_t payload[2] = {gain, dataRate};
-    return bridgeTransaction(CMD_CONFIGURE_ADC, payload, 2, nullptr, nullptr);
+    // Get the raw reading from the ADS
+    int16_t rawReading = getRaw();
+
+    return rawToPPM(rawReading);
 }
 
-bool ElectrochemicalGasSensor::sendConfigureLmp(uint8_t tiacn, uint8_t refcn, uint8_t modecn)
-{
-    uint8_t payload[3] = {tiacn, refcn, modecn};
-    return bridgeTransaction(CMD_CONFIGURE_LMP, payload, 3, nullptr, nullptr);
+#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
+/**
+ * @brief                   Calculate the PPM value of the measured gas from the voltage on the ADC
+ *
+ * @note                    Step-by-step version of the conversion precomputed in updateConversion(),
+ *                          only used by rawToPPM() to print the intermediate values when debugging
+ *
+ * @param double voltage    The voltage measured by the ADS, in volts
+ *
+ * @returns                 double value of the PPM
+ *
+ */
+double ElectrochemicalGasSensor::voltageToPPM(double voltage)
+{
+    Serial.println();
+    Serial.println("Electrochemical gas sensor readings:");
+    Serial.print("Raw voltage measurement: ");
+    Serial.print(voltage, 10);
+    Serial.println(" V");
+
+    // Calculate current and calculate PPM based on datasheet, a differential reading has no reference in it
+    double voltsNoRef = differential ? voltage : voltage - (REF_VOLTAGE * (internalZeroPercent / 100.0F));
+
+    Serial.print("Voltage without reference value: ");
+    Serial.print(voltsNoRef, 10);
+    Serial.println(" V");
+
+    voltsNoRef += type.internalZeroCalibration; // Add the calibration value as well
+
+    Serial.print("Voltage after calibration: ");
+    Serial.print(voltsNoRef, 10);
+    Serial.println(" V");
+    Serial.println("");
+
+    double current = voltsNoRef / tiaGainInKOHms;
+    double ppm = current / (type.nanoAmperesPerPPM * (double)1e-9);
+
+    // Temperature compensation, see updateCompensation()
+    ppm = (ppm - compZeroPpm) / compSensitivity;
+
+    Serial.print("PPM after temperature compensation: ");
+    Serial.println(ppm, 10);
+
+    // Due to noise when making really small precise measurements (in ppb)
+    // ppm can sometimes go into negative due to noise - just round it to zero
+    if (ppm < 0)
+        ppm = 0;
+    return ppm;
+}
+#endif
+
+/**
+ * @brief                   Start a measurement without waiting for the conversion to finish
+ *
+ * @note                    Use isMeasurementReady() to check when it's done and readPPM() to get the result.
+ *                          This lets you start conversions on multiple boards and collect them later.
+ *
+ * @returns                 True if the measurement was started, false if it failed
+ *
+ */
+bool ElectrochemicalGasSensor::requestMeasurement()
+{
+    autoRangeApply();
+
+    measurementPending = true;
+    measurementFailed = false;
+    measurementRaw = 0;
+
+    if (mode == TransportMode::LEGACY_DIRECT)
+    {
+        measurementDiscard = selectSignal() && discardAfterSwitch;
+        requestSignal();
+        measurementStartUs = micros();
+        measurementNextPollUs = conversionTimeUs();
+        return true;
+    }
+
+    // TransportMode::BRIDGE - only send the command here, the response is polled in isMeasurementReady()
+    if (!bridgeSendCommand(CMD_TRIGGER_ADC, nullptr, 0))
+    {
+        measurementPending = false;
+        measurementFailed = true;
+        return false;
+    }
+    bridgeSplitStart(CMD_TRIGGER_ADC);
+    return true;
+}
+
+/**
+ * @brief                   Check if the measurement started with requestMeasurement() is done
+ *
+ * @note                    Doesn't wait. The status is only read once the conversion can be done, calling it
+ *                          more often costs no I2C traffic. Also returns true if the measurement failed or
+ *                          timed out, readPPM() will then return -1.
+ *
+ * @returns                 True if the result can be read with readPPM()
+ *
+ */
+bool ElectrochemicalGasSensor::isMeasurementReady()
+{
+    if (!measurementPending)
+        return true;
+
+    if (mode == TransportMode::LEGACY_DIRECT)
+    {
+        // No point in reading the config register before the conversion can be done
+        if (micros() - measurementStartUs < measurementNextPollUs)
+            return false;
+
+        if (!ads->isReady())
+        {
+            // A failed read looks busy as well, give up once the conversion should long be done
+            unsigned long elapsedUs = micros() - measurementStartUs;
+            if (elapsedUs < ADS_TIMEOUT_CONVERSIONS * conversionTimeUs() + ADS_TIMEOUT_MARGIN_US)
+            {
+                measurementNextPollUs = elapsedUs + ADS_POLL_INTERVAL_US;
+                return false;
+            }
+            measurementFailed = true;
+            measurementPending = false;
+            return true;
+        }
+
+        // That was the conversion thrown away after the mux switched, start the one to keep
+        if (measurementDiscard)
+        {
+            measurementDiscard = false;
+            requestSignal();
+            measurementStartUs = micros();
+            measurementNextPollUs = conversionTimeUs();
+            return false;
+        }
+
+        measurementRaw = ads->getValue();
+        measurementPending = false;
+        autoRangeCheck(measurementRaw);
+        return true;
+    }
+
+    // TransportMode::BRIDGE
+    uint8_t hi = 0, lo = 0;
+    uint8_t status = bridgeSplitPoll(&hi, &lo);
+    if (status == BRIDGE_STATUS_BUSY)
+        return false;
+
+    if (status == BRIDGE_STATUS_OK)
+    {
+        measurementRaw = (int16_t)(((uint16_t)hi << 8) | lo);
+        measurementPending = false;
+        autoRangeCheck(measurementRaw);
+        return true;
+    }
+
+    // Error or timeout
+    measurementFailed = true;
+    measurementPending = false;
+    return true;
+}
+
+/**
+ * @brief                   Get the PPM value of the measurement started with requestMeasurement()
+ *
+ * @note                    Waits for the measurement if it's not ready yet
+ *
+ * @returns                 double value of the PPM, -1 if the measurement failed
+ *
+ */
+double ElectrochemicalGasSensor::readPPM()
+{
+    while (!isMeasurementReady())
+        yield();
+
+    if (measurementFailed)
+        return -1;
+
+    return rawToPPM(measurementRaw);
+}
+
+/**
+ * @brief                   Set the data rate of the ADS1115
+ *
+ * @note                    Can be called before or after begin(). Faster rates are noisier.
+ *
+ * @param uint8_t _dataRate 0 (8 SPS) to 7 (860 SPS), invalid values are mapped to 4 (128 SPS)
+ *
+ */
+void ElectrochemicalGasSensor::setDataRate(uint8_t _dataRate)
+{
+    dataRate = (_dataRate > 7) ? 4 : _dataRate;
+
+    // Not initialized yet, begin() will apply it
+    if (ads == nullptr)
+        return;
+
+    ads->setDataRate(dataRate);
+    if (mode == TransportMode::BRIDGE)
+        sendConfigureAdc(type.adsGain, dataRate);
+}
+
+/**
+ * @brief                   Get the data rate of the ADS1115
+ *
+ * @returns                 0 (8 SPS) to 7 (860 SPS)
+ *
+ */
+uint8_t ElectrochemicalGasSensor::getDataRate()
+{
+    return dataRate;
+}
+
+/**
+ * @brief                   Put the ADS1115 in continuous conversion mode and start filling the sample buffer
+ *
+ * @note                    Call updateStreaming() often enough (at least once per sample period on legacy
+ *                          boards) and drain the samples with readSamples(). On bridge boards the ATtiny
+ *                          samples into its own FIFO and updateStreaming() reads it out in bursts.
+ *                          Don't use the other measurement functions until stopStreaming() is called,
+ *                          which also puts the data rate from before back.
+ *
+ * @param uint8_t _dataRate 0 (8 SPS) to 7 (860 SPS)
+ *
+ * @returns                 True if streaming was started, false if it failed
+ *
+ */
+bool ElectrochemicalGasSensor::startStreaming(uint8_t _dataRate)
+{
+    // The ADS1115 can't convert continuously for one cell while others share it
+    if (ads == nullptr || adcOwner != nullptr || adsShared)
+        return false;
+
+    streamHead = 0;
+    streamTail = 0;
+    streamOverruns = 0;
+    if (!streaming)
+        streamDataRateBefore = dataRate;
+
+    if (mode == TransportMode::BRIDGE)
+    {
+        // The bridge samples into its own FIFO, updateStreaming() drains it in bursts
+        dataRate = (_dataRate > 7) ? 4 : _dataRate;
+        ads->setDataRate(dataRate);
+        streamPeriodUs = conversionTimeUs();
+
+        uint8_t payload[1] = {dataRate};
+        if (!bridgeTransaction(CMD_START_STREAM, payload, 1, nullptr, nullptr))
+        {
+            dataRate = streamDataRateBefore;
+            ads->setDataRate(dataRate);
+            return false;
+        }
+
+        streamLastUs = micros();
+        streaming = true;
+        return true;
+    }
+
+    // The comparator and the continuous mode can only be used for one of the two
+    disableAlarm();
+
+    setDataRate(_dataRate);
+    streamPeriodUs = conversionTimeUs();
+
+    // Writing the config once in continuous mode starts the conversions, after that
+    // only the conversion register has to be read
+    ads->setMode(0);
+    requestSignal();
+
+    streamLastUs = micros();
+    streaming = true;
+    return true;
+}
+
+/**
+ * @brief                   Start streaming, reading a sample only when the ADS1115 signals one on ALERT/RDY
+ *
+ * @note                    Only for legacy direct-wired boards, with the ALERT/RDY pin connected to
+ *                          an interrupt capable GPIO. The ISR only counts the ready pulses - the sample
+ *                          is read from updateStreaming(), since I2C can't be used inside an ISR.
+ *                          The comparator is used for the RDY signal, so it can't be used for alarms meanwhile.
+ *
+ * @param uint8_t _rdyPin   GPIO connected to ALERT/RDY
+ *
+ * @param uint8_t _dataRate 0 (8 SPS) to 7 (860 SPS)
+ *
+ * @returns                 True if streaming was started, false if it's not supported or all
+ *                          RDY_MAX_SENSORS interrupt slots are taken
+ *
+ */
+bool ElectrochemicalGasSensor::startInterruptStreaming(uint8_t _rdyPin, uint8_t _dataRate)
+{
+    if (mode != TransportMode::LEGACY_DIRECT || ads == nullptr || adcOwner != nullptr || adsShared)
+        return false;
+
+    int interrupt = digitalPinToInterrupt(_rdyPin);
+    if (interrupt == NOT_AN_INTERRUPT)
+        return false;
+
+    // Find a free ISR for this object
+    if (streaming)
+        stopStreaming();
+    disableAlarm();
+    for (int8_t i = 0; i < RDY_MAX_SENSORS && rdySlot == -1; i++)
+    {
+        if (rdyInstances[i] == nullptr)
+            rdySlot = i;
+    }
+    if (rdySlot == -1)
+        return false;
+
+    // Hi_thresh MSB = 1 and Lo_thresh MSB = 0 turn ALERT into a conversion ready signal,
+    // asserted after every conversion
+    ads->setComparatorThresholdLow(0x0000);
+    ads->setComparatorThresholdHigh((int16_t)0x8000);
+    ads->setComparatorMode(0);
+    ads->setComparatorLatch(0);
+    ads->setComparatorQueConvert(0);
+
+    // ALERT/RDY is open drain
+    pinMode(_rdyPin, INPUT_PULLUP);
+
+    rdyPin = _rdyPin;
+    rdyPending = 0;
+    rdyInstances[rdySlot] = this;
+
+    static void (*const isrs[RDY_MAX_SENSORS])() = {rdyIsr0, rdyIsr1, rdyIsr2, rdyIsr3};
+    // getComparatorPolarity() returns the raw config bit, 1 = ALERT/RDY active high
+    attachInterrupt(interrupt, isrs[rdySlot], ads->getComparatorPolarity() ? RISING : FALLING);
+
+    // Starts the continuous conversions with the comparator config written as well
+    if (!startStreaming(_dataRate))
+    {
+        stopStreaming();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief                   Stop streaming and put the ADS1115 back in single-shot mode
+ *
+ */
+void ElectrochemicalGasSensor::stopStreaming()
+{
+    if (!streaming && rdyPin == -1)
+        return;
+
+    if (rdyPin != -1)
+    {
+        detachInterrupt(digitalPinToInterrupt(rdyPin));
+        rdyInstances[rdySlot] = nullptr;
+        rdySlot = -1;
+        rdyPin = -1;
+
+        // Disable the comparator again and put the thresholds back to their reset values
+        ads->setComparatorQueConvert(3);
+        ads->setComparatorThresholdLow((int16_t)0x8000);
+        ads->setComparatorThresholdHigh(0x7FFF);
+    }
+
+    streaming = false;
+
+    // Back to the data rate of the single-shot measurements
+    uint8_t streamDataRate = dataRate;
+    dataRate = streamDataRateBefore;
+    ads->setDataRate(dataRate);
+
+    if (mode == TransportMode::BRIDGE)
+    {
+        bridgeTransaction(CMD_STOP_STREAM, nullptr, 0, nullptr, nullptr);
+        // The bridge keeps the streaming data rate otherwise
+        if (dataRate != streamDataRate)
+            sendConfigureAdc(type.adsGain, dataRate);
+        return;
+    }
+
+    ads->setMode(1);
+    requestSignal(); // Write the single-shot config so the ADS stops converting
+}
+
+/**
+ * @brief                   Check if the sensor is in streaming mode
+ *
+ * @returns                 True if startStreaming() was called and stopStreaming() wasn't
+ *
+ */
+bool ElectrochemicalGasSensor::isStreaming()
+{
+    return streaming;
+}
+
+/**
+ * @brief                   Read a new sample into the buffer if one is due
+ *
+ * @note                    Only reads the conversion register, never writes the config
+ *
+ * @returns                 True if a sample was read
+ *
+ */
+bool ElectrochemicalGasSensor::updateStreaming()
+{
+    if (!streaming)
+        return false;
+
+    // In interrupt mode, only touch the bus once the ADS1115 said a conversion is done
+    if (rdyPin != -1)
+    {
+        if (rdyPending == 0)
+            return false;
+
+        noInterrupts();
+        uint8_t pending = rdyPending;
+        rdyPending = 0;
+        interrupts();
+
+        // More than one RDY pulse means conversions were overwritten before we got to them
+        streamOverruns += pending - 1;
+
+        pushStreamSample(ads->getValue());
+        return true;
+    }
+
+    unsigned long now = micros();
+
+    // The bridge FIFO is drained once about half a burst worth of samples should be waiting
+    if (mode == TransportMode::BRIDGE)
+    {
+        if (now - streamLastUs < streamPeriodUs * (BRIDGE_STREAM_MAX_BURST / 2))
+            return false;
+        streamLastUs = now;
+
+        int16_t burst[BRIDGE_STREAM_MAX_BURST];
+        uint8_t n = readBridgeSamples(burst, BRIDGE_STREAM_MAX_BURST);
+        for (uint8_t i = 0; i < n; i++)
+            pushStreamSample(burst[i]);
+        return n != 0;
+    }
+
+    if (now - streamLastUs < streamPeriodUs)
+        return false;
+
+    // If we fell behind by more than a sample, skip ahead instead of reading the same conversion twice
+    if (now - streamLastUs >= 2 * streamPeriodUs)
+        streamLastUs = now;
+    else
+        streamLastUs += streamPeriodUs;
+
+    pushStreamSample(ads->getValue());
+    return true;
+}
+
+/**
+ * @brief                   Get how many samples are waiting in the buffer
+ *
+ * @returns                 Number of samples which can be read with readSamples()
+ *
+ */
+uint8_t ElectrochemicalGasSensor::availableSamples()
+{
+    return (uint8_t)(streamHead - streamTail) & (STREAM_BUFFER_SIZE - 1);
+}
+
+/**
+ * @brief                   Take raw ADC samples out of the streaming buffer
+ *
+ * @note                    Convert them with rawToPPM() if needed
+ *
+ * @param int16_t *_buf     Where to copy the samples
+ *
+ * @param uint8_t _n        Maximum number of samples to copy
+ *
+ * @returns                 Number of samples copied
+ *
+ */
+uint8_t ElectrochemicalGasSensor::readSamples(int16_t *_buf, uint8_t _n)
+{
+    updateStreaming();
+
+    uint8_t copied = 0;
+    uint8_t tail = streamTail;
+    while (copied < _n && tail != streamHead)
+    {
+        _buf[copied++] = streamBuffer[tail];
+        tail = (tail + 1) & (STREAM_BUFFER_SIZE - 1);
+    }
+    streamTail = tail;
+    return copied;
+}
+
+/**
+ * @brief                   Get how many samples were dropped because the buffer was full
+ *
+ * @returns                 Number of dropped samples since streaming was started
+ *
+ */
+uint16_t ElectrochemicalGasSensor::getStreamOverruns()
+{
+    return streamOverruns;
+}
+
+/**
+ * @brief                   Calculate the PPM value from a raw ADC sample
+ *
+ * @param int16_t _raw      Raw reading, e.g. from readSamples()
+ *
+ * @returns                 double value of the PPM
+ *
+ */
+double ElectrochemicalGasSensor::rawToPPM(int16_t _raw)
+{
+#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
+    voltageToPPM(ads->toVoltage(_raw));
+#endif
+
+    // Slope and offset are precomputed in updateConversion()
+    double ppm = _raw * ppmSlope + ppmOffset;
+
+    // Due to noise when making really small precise measurements (in ppb)
+    // ppm can sometimes go into negative due to noise - just round it to zero
+    if (ppm < 0)
+        ppm = 0;
+    return ppm;
+}
+
+/**
+ * @brief                   Calculate the raw ADC reading which corresponds to a PPM value
+ *
+ * @note                    The inverse of rawToPPM(), except it doesn't round negative values to zero
+ *
+ * @param double _ppm       The PPM value
+ *
+ * @returns                 Raw ADC reading, clamped to the range of the ADC
+ *
+ */
+int16_t ElectrochemicalGasSensor::ppmToRaw(double _ppm)
+{
+    double raw = (_ppm - ppmOffset) / ppmSlope;
+    if (raw > 32767)
+        return 32767;
+    if (raw < -32768)
+        return -32768;
+    return (int16_t)raw;
+}
+
+/**
+ * @brief                   Let the ADS1115 watch the gas concentration and latch ALERT/RDY if it goes out of range
+ *
+ * @note                    Only for legacy direct-wired boards. The ADS1115 is put in continuous
+ *                          conversion mode at the current data rate, so it can't be used with streaming.
+ *                          ALERT/RDY is active low and stays latched until clearAlarm() is called.
+ *
+ * @param double _lowPpm        Alarm if the concentration goes below this, 0 or less for a high-only alarm,
+ *                              so noise around a clean air reading can't trigger it
+ *
+ * @param double _highPpm       Alarm if the concentration goes above this
+ *
+ * @param uint8_t _conversions  How many out-of-range conversions in a row trigger the alarm: 1, 2 or 4
+ *
+ * @returns                 True if the alarm was set up, false if the board doesn't support it
+ *
+ */
+bool ElectrochemicalGasSensor::setAlarmThresholdsPPM(double _lowPpm, double _highPpm, uint8_t _conversions)
+{
+    if (mode != TransportMode::LEGACY_DIRECT || ads == nullptr || adcOwner != nullptr || adsShared)
+        return false;
+
+    if (streaming)
+        stopStreaming();
+
+    // Sensors with a negative nanoAmperesPerPPM give lower readings for higher concentrations
+    int16_t rawA = ppmToRaw(_lowPpm);
+    int16_t rawB = ppmToRaw(_highPpm);
+    // High-only, the low side of the window goes to the end of the ADC range which no reading can pass
+    if (_lowPpm <= 0)
+        rawA = ppmSlope > 0 ? -32768 : 32767;
+    ads->setComparatorThresholdLow(rawA < rawB ? rawA : rawB);
+    ads->setComparatorThresholdHigh(rawA < rawB ? rawB : rawA);
+
+    ads->setComparatorMode(1); // window
+    ads->setComparatorPolarity(0);
+    ads->setComparatorLatch(1);
+    if (_conversions >= 4)
+        ads->setComparatorQueConvert(2);
+    else if (_conversions >= 2)
+        ads->setComparatorQueConvert(1);
+    else
+        ads->setComparatorQueConvert(0);
+
+    // Start converting continuously, this also writes the comparator config
+    ads->setMode(0);
+    requestSignal();
+
+    alarmEnabled = true;
+    return true;
+}
+
+/**
+ * @brief                   Release a latched alarm
+ *
+ * @note                    Reading the conversion register is what releases ALERT/RDY.
+ *                          If the concentration is still out of range, it's latched again.
+ *
+ * @returns                 double value of the PPM of the last conversion, -1 if the alarm isn't set up
+ *
+ */
+double ElectrochemicalGasSensor::clearAlarm()
+{
+    if (!alarmEnabled)
+        return -1;
+
+    return rawToPPM(ads->getValue());
+}
+
+/**
+ * @brief                   Stop the hardware alarm and put the ADS1115 back in single-shot mode
+ *
+ */
+void ElectrochemicalGasSensor::disableAlarm()
+{
+    if (!alarmEnabled)
+        return;
+
+    alarmEnabled = false;
+
+    // Disable the comparator and put everything back to the reset values
+    ads->setComparatorQueConvert(3);
+    ads->setComparatorMode(0);
+    ads->setComparatorLatch(0);
+    ads->setComparatorThresholdLow((int16_t)0x8000);
+    ads->setComparatorThresholdHigh(0x7FFF);
+    ads->setMode(1);
+    requestSignal();
+}
+
+/**
+ * @brief                   Called from the ALERT/RDY ISR, only counts the conversion
+ *
+ */
+void IRAM_ATTR ElectrochemicalGasSensor::onRdy()
+{
+    if (rdyPending != 255)
+        rdyPending++;
+}
+
+void IRAM_ATTR ElectrochemicalGasSensor::rdyIsr0()
+{
+    rdyInstances[0]->onRdy();
+}
+
+void IRAM_ATTR ElectrochemicalGasSensor::rdyIsr1()
+{
+    rdyInstances[1]->onRdy();
+}
+
+void IRAM_ATTR ElectrochemicalGasSensor::rdyIsr2()
+{
+    rdyInstances[2]->onRdy();
+}
+
+void IRAM_ATTR ElectrochemicalGasSensor::rdyIsr3()
+{
+    rdyInstances[3]->onRdy();
+}
+
+/**
+ * @brief                   Add a sample to the streaming buffer, or count an overrun if it's full
+ *
+ */
+void ElectrochemicalGasSensor::pushStreamSample(int16_t _raw)
+{
+    uint8_t head = streamHead;
+    uint8_t next = (head + 1) & (STREAM_BUFFER_SIZE - 1);
+    if (next == streamTail)
+    {
+        streamOverruns++;
+        return;
+    }
+    streamBuffer[head] = _raw;
+    streamHead = next;
+}
+
+/**
+ * @brief                   Calcualte PPB values from PPM
+ *
+ * @returns                 double value of PPB
+ *
+ */
+double ElectrochemicalGasSensor::getPPB()
+{
+    return getPPM() * 1000.0;
+}
+
+/**
+ * @brief                               Calculate an averaged PPM measurement from a number of separate measurements
+ *
+ * @note                                This is a blocking function, it won't exit until it's completed
+ *
+ * @param uint8_t _numMeasurements     How many measurements to do
+ *
+ * @param uint8_t _secondsDelay         How many seconds to wait between each measurement
+ *
+ * @returns                 double value of the calculated averaged PPM
+ *
+ */
+double ElectrochemicalGasSensor::getAveragedPPM(uint8_t _numMeasurements, uint8_t _secondsDelay)
+{
+    double totalMeasurements = 0;
+
+    // Sum all the separate measurements
+    for (int i = 0; i < _numMeasurements; i++)
+    {
+        // Make the individual measurement
+        totalMeasurements += getPPM();
+        // Wait for the set number of seconds
+        delay(1000 * _secondsDelay);
+    }
+
+    // Return the final value
+    return totalMeasurements / _numMeasurements;
+}
+
+/**
+ * @brief                               Calculate an averaged PPB measurement from a number of separate measurements
+ *
+ * @note                                This is a blocking function, it won't exit until it's completed
+ *
+ * @param uint8_t _numMeasurements     How many measurements to do
+ *
+ * @param uint8_t _secondsDelay         How many seconds to wait between each measurement
+ *
+ * @returns                 double value of the calculated averaged PPB
+ *
+ */
+double ElectrochemicalGasSensor::getAveragedPPB(uint8_t _numMeasurements, uint8_t _secondsDelay)
+{
+    return getAveragedPPM(_numMeasurements, _secondsDelay) * 1000;
+}
+
+/**
+ * @brief                               Start a non-blocking averaged measurement
+ *
+ * @note                                The measurements are made from poll(), which has to be called
+ *                                      repeatedly (e.g. from loop()) until isAveragingDone() returns true.
+ *                                      A failed measurement isn't repeated, it's left out of the average.
+ *                                      That includes one which timed out because the board is gone,
+ *                                      legacy and bridge boards alike, so the averaging always finishes.
+ *
+ * @param uint8_t _numMeasurements      How many measurements to do
+ *
+ * @param unsigned long _intervalMs     How many milliseconds to wait between each measurement
+ *
+ */
+void ElectrochemicalGasSensor::startAveraging(uint8_t _numMeasurements, unsigned long _intervalMs)
+{
+    avgTarget = _numMeasurements;
+    avgCount = 0;
+    avgAttempts = 0;
+    avgSum = 0;
+    avgIntervalMs = _intervalMs;
+    avgStarted = false;
+    avgWaitingForResult = false;
+    avgRunning = (_numMeasurements != 0);
+}
+
+/**
+ * @brief                   Advance the averaged measurement started with startAveraging()
+ *
+ * @note                    Starts or collects at most one measurement per call and never waits for the ADC
+ *
+ * @returns                 True if the averaged measurement is done, false if it's still running
+ *
+ */
+bool ElectrochemicalGasSensor::poll()
+{
+    if (!avgRunning)
+        return isAveragingDone();
+
+    // A conversion is in progress, collect it once it's done
+    if (avgWaitingForResult)
+    {
+        if (!isMeasurementReady())
+            return false;
+
+        avgWaitingForResult = false;
+        double ppm = readPPM();
+        if (ppm >= 0)
+        {
+            avgSum += ppm;
+            avgCount++;
+        }
+        return avgAttempted();
+    }
+
+    // The first measurement is started right away, the rest once the interval has passed
+    unsigned long now = millis();
+    if (avgStarted && now - avgLastSampleMs < avgIntervalMs)
+        return false;
+
+    avgStarted = true;
+    avgLastSampleMs = now;
+    avgWaitingForResult = requestMeasurement();
+
+    // Couldn't even start it, that's a failed measurement too
+    if (!avgWaitingForResult)
+        return avgAttempted();
+
+    return false;
+}
+
+// Count one measurement of the averaging, successful or not, and finish it after the last one
+bool ElectrochemicalGasSensor::avgAttempted()
+{
+    avgAttempts++;
+    if (avgAttempts >= avgTarget)
+        avgRunning = false;
+
+    return isAveragingDone();
+}
+
+/**
+ * @brief                   Check if the averaged measurement started with startAveraging() is done
+ *
+ * @returns                 True if all the measurements were made, also when some or all of them failed
+ *
+ */
+bool ElectrochemicalGasSensor::isAveragingDone()
+{
+    return !avgRunning && avgAttempts != 0 && avgAttempts >= avgTarget;
+}
+
+/**
+ * @brief                   Get the result of the averaged measurement started with startAveraging()
+ *
+ * @returns                 double value of the averaged PPM, or the average so far if it's not done yet.
+ *                          -1 if no measurement succeeded (yet)
+ *
+ */
+double ElectrochemicalGasSensor::getAverageResult()
+{
+    if (avgCount == 0)
+        return -1;
+    return avgSum / avgCount;
+}
+
+/**
+ * @brief                              Get the actual number of the kOhms in the TIA gain
+ *
+ * @note                                Only used internally in the class
+ *
+ * @returns                 float of the TIA gain depending on the config
+ *
+ */
+float ElectrochemicalGasSensor::getTiaGain()
+{
+    if (compiled != nullptr)
+        return compiled->tiaGain;
+    // The resistor on the board can't be known, it's -1 until setCustomTiaGain()
+    if (type.TIA_GAIN_IN_KOHMS == TIA_GAIN_EXTERNAL)
+        return customTiaGain;
+    return tiaGainFromCode(type.TIA_GAIN_IN_KOHMS);
+}
+
+/**
+ * @brief           Set a custom number of the kOhms in the TIA gain
+ *
+ * @note            This is if you're using an external resistor. With TIA_GAIN_EXTERNAL it's kept when
+ *                  begin() is called again.
+ *
+ * @returns         None
+ *
+ */
+void ElectrochemicalGasSensor::setCustomTiaGain(float _tiaGain)
+{
+    customTiaGain = _tiaGain;
+    tiaGainInKOHms = _tiaGain;
+    updateConversion();
+}
+
+/**
+ * @brief           Get the internal zero % setting as an actual float
+ *
+ * @returns         The internal zero as a float
+ *
+ */
+float ElectrochemicalGasSensor::getInternalZeroPercent()
+{
+    if (compiled != nullptr)
+        return compiled->internalZeroPercent;
+    // INTERNAL_ZERO_BYPASSED is not implemented, just the standard internal zero mode
+    return internalZeroPercentFromCode(type.INTERNAL_ZERO);
+}
+
+// The LMP91000 register values of the current config, from the compiler for ElectrochemicalGasSensorT
+uint8_t ElectrochemicalGasSensor::lmpTiacnValue()
+{
+    return compiled != nullptr ? compiled->tiacn : lmpTiacn(type);
+}
+
+uint8_t ElectrochemicalGasSensor::lmpRefcnValue()
+{
+    return compiled != nullptr ? compiled->refcn : lmpRefcn(type);
+}
+
+uint8_t ElectrochemicalGasSensor::lmpModecnValue()
+{
+    return compiled != nullptr ? compiled->modecn : lmpModecn(type);
+}
+
+/**
+ * @brief                   Set a custom value for the zero calibration
+ *
+ * @param calibration       Voltage level at 0ppm
+ *
+ */
+void ElectrochemicalGasSensor::setCustomZeroCalibration(double calibration)
+{
+    type.internalZeroCalibration=calibration;
+    updateConversion();
+}
+
+/**
+ * @brief                   Measure the temperature with the sensor in the LMP91000
+ *
+ * @note                    Switches the LMP91000 to the temperature mode with the TIA on, so the cell stays
+ *                          biased, makes one conversion and switches back. Legacy boards wait
+ *                          TEMPERATURE_SETTLING_MS for VOUT to settle, bridge boards do it all in two
+ *                          transactions. Not possible while streaming or with the alarm enabled.
+ *                          The result is cached for getTemperature() and the temperature compensation.
+ *
+ * @returns                 True if it was successful, false if it failed
+ *
+ */
+bool ElectrochemicalGasSensor::measureTemperature()
+{
+    // The ADS1115 is busy with continuous conversions then
+    if (ads == nullptr || streaming || alarmEnabled)
+        return false;
+
+    SENSOR_STATS_START();
+
+    uint8_t tiacn = lmpTiacnValue();
+    uint8_t refcn = lmpRefcnValue();
+    uint8_t modecn = lmpModecnValue();
+    uint8_t tempModecn = (uint8_t)((type.FET_SHORT << 7) | OP_MODE_TEMPERATURE_TIA_ON);
+    uint8_t gain = ads->getGain();
+    int16_t raw = 0;
+    bool ok;
+
+    if (mode == TransportMode::LEGACY_DIRECT)
+    {
+        // Only MODECN changes, so the LMP91000 driver writes just that register each way
+        ok = writeLmpConfig(tempModecn);
+        if (ok)
+        {
+            delay(TEMPERATURE_SETTLING_MS);
+            ads->setGain(TEMPERATURE_ADS_GAIN);
+            raw = ads->readADC(channel);
+            ads->setGain(gain);
+            // The mux didn't move, but the input did
+            adcHost()->adsMux = ADS_MUX_UNKNOWN;
+        }
+        ok = writeLmpConfig(modecn) && ok;
+    }
+    else // TransportMode::BRIDGE
+    {
+        ok = configureAndReadAdc(TEMPERATURE_ADS_GAIN, tiacn, refcn, tempModecn, raw);
+        // Bridge firmware without the batched commands answers with an error, use the separate commands then
+        bool batched = ok || bridgeLastStatus != BRIDGE_STATUS_ERROR;
+        if (!batched)
+            ok = sendConfigureAdc(TEMPERATURE_ADS_GAIN, dataRate) && sendConfigureLmp(tiacn, refcn, tempModecn) &&
+                 triggerAndReadAdc(raw);
+
+        // Back to measuring gas, also if the temperature reading failed half way
+        bool restored = batched ? sendConfigureAll(gain, dataRate, tiacn, refcn, modecn)
+                                : sendConfigureAdc(gain, dataRate) && sendConfigureLmp(tiacn, refcn, modecn);
+        ok = restored && ok;
+    }
+
+    if (ok)
+    {
+        float mv = raw * (adsMaxVoltageFromGain(TEMPERATURE_ADS_GAIN) * 1000.0F / 32767.0F);
+        temperatureC = (mv - LMP_TEMPERATURE_MV_AT_0C) / LMP_TEMPERATURE_MV_PER_C;
+        updateCompensation();
+    }
+
+    SENSOR_STATS_RECORD(stats.temperature);
+    return ok;
+}
+
+/**
+ * @brief                   Get the temperature from the last measureTemperature(), without measuring
+ *
+ * @returns                 The temperature in degrees C, TEMPERATURE_INVALID if it was never measured
+ *
+ */
+float ElectrochemicalGasSensor::getTemperature()
+{
+    return temperatureC;
+}
+
+/**
+ * @brief                   Interleave temperature readings with the gas readings
+ *
+ * @note                    getRaw() (and so getPPM() and the others) then measures the temperature first on
+ *                          every _interval-th call, starting with the next one. That call takes one temperature
+ *                          reading longer, the others cost nothing extra. requestMeasurement(), poll() and
+ *                          GasSensorArray never wait for a temperature reading, call measureTemperature()
+ *                          between them when it suits you.
+ *
+ * @param uint8_t _interval One temperature reading per this many gas readings, 0 to disable (default)
+ *
+ */
+void ElectrochemicalGasSensor::setTemperatureInterval(uint8_t _interval)
+{
+    temperatureInterval = _interval;
+    temperatureCountdown = 0;
+}
+
+/**
+ * @brief                   Set the temperature curve of the cell, for the temperature compensated PPM
+ *
+ * @note                    The curve has to stay valid while it's used, it's not copied.
+ *                          The compensation is applied once a temperature has been measured.
+ *
+ * @param const temperatureCurve *_curve    The curve, see sensorConfigData.h, nullptr to disable (default)
+ *
+ */
+void ElectrochemicalGasSensor::setTemperatureCurve(const temperatureCurve *_curve)
+{
+    tempCurve = _curve;
+    updateCompensation();
+}
+
+// Measure the temperature before every temperatureInterval-th blocking measurement, see setTemperatureInterval()
+void ElectrochemicalGasSensor::interleaveTemperature()
+{
+    if (temperatureInterval == 0 || streaming || alarmEnabled)
+        return;
+
+    if (temperatureCountdown == 0)
+    {
+        measureTemperature();
+        temperatureCountdown = temperatureInterval;
+    }
+    temperatureCountdown--;
+}
+
+/**
+ * @brief                   Let the ADS1115 PGA and the LMP91000 TIA gain follow the signal
+ *
+ * @note                    Each reading is checked and a new range is switched to before the next measurement,
+ *                          so a reading is always converted with the range it was made with.
+ *                          The PGA is stepped first, it costs no I2C traffic on legacy boards and doesn't disturb
+ *                          the cell. The TIA gain is only changed when the TIA output gets close to the rail,
+ *                          or when the PGA is at its smallest range and the signal would still fit after the step.
+ *                          After a TIA gain change the range stays put for AUTORANGE_TIA_SETTLING_MS.
+ *                          Boards with an external TIA gain only range the PGA. Not used while streaming or with
+ *                          the alarm, and getFilteredPPM() can mix readings from different ranges.
+ *                          Turning it off keeps the current range.
+ *
+ * @param uint8_t _mode     AUTORANGE_OFF (default), AUTORANGE_PGA or AUTORANGE_PGA_TIA
+ *
+ */
+void ElectrochemicalGasSensor::setAutoRange(uint8_t _mode)
+{
+    autoRange = _mode;
+    rangeAdsGain = type.adsGain;
+    rangeTiaGain = type.TIA_GAIN_IN_KOHMS;
+}
+
+/**
+ * @brief                   Get the current ADS1115 gain, which auto-ranging may have changed
+ *
+ * @returns                 ADS_GAIN_6_144V to ADS_GAIN_0_256V
+ *
+ */
+uint8_t ElectrochemicalGasSensor::getAdsGain()
+{
+    return type.adsGain;
+}
+
+/**
+ * @brief                   Get the current LMP91000 TIA gain, which auto-ranging may have changed
+ *
+ * @returns                 TIA_GAIN_EXTERNAL to TIA_GAIN_350_KOHM
+ *
+ */
+uint8_t ElectrochemicalGasSensor::getTiaGainCode()
+{
+    return type.TIA_GAIN_IN_KOHMS;
+}
+
+// ADS1115 gains from the biggest to the smallest range
+static const uint8_t autoRangeAdsGains[] = {ADS_GAIN_6_144V, ADS_GAIN_4_096V, ADS_GAIN_2_048V,
+                                            ADS_GAIN_1_024V, ADS_GAIN_0_512V, ADS_GAIN_0_256V};
+#define AUTORANGE_ADS_GAINS (sizeof(autoRangeAdsGains) / sizeof(autoRangeAdsGains[0]))
+
+// Pick the range for the next measurement from a reading, see setAutoRange()
+void ElectrochemicalGasSensor::autoRangeCheck(int16_t _raw)
+{
+    if (autoRange == AUTORANGE_OFF || streaming || alarmEnabled)
+        return;
+
+    if (autoRangeSettling)
+    {
+        if (millis() - autoRangeChangeMs < AUTORANGE_TIA_SETTLING_MS)
+            return;
+        autoRangeSettling = false;
+    }
+
+    uint8_t pga = 0;
+    while (pga < AUTORANGE_ADS_GAINS - 1 && autoRangeAdsGains[pga] != type.adsGain)
+        pga++;
+
+    // PGA first: a bigger range when the reading clips, a smaller one when it fits there with headroom
+    long code = _raw < 0 ? -(long)_raw : _raw;
+    if (code >= AUTORANGE_PGA_HIGH_CODE)
+    {
+        if (pga > 0)
+        {
+            rangeAdsGain = autoRangeAdsGains[pga - 1];
+            return;
+        }
+    }
+    else if (pga < AUTORANGE_ADS_GAINS - 1)
+    {
+        float smaller = adsMaxVoltageFromGain(autoRangeAdsGains[pga + 1]);
+        if (code * adsMaxVoltageFromGain(type.adsGain) < AUTORANGE_PGA_LOW * smaller * 32767.0F)
+        {
+            rangeAdsGain = autoRangeAdsGains[pga + 1];
+            return;
+        }
+    }
+
+    if (autoRange != AUTORANGE_PGA_TIA || type.TIA_GAIN_IN_KOHMS == TIA_GAIN_EXTERNAL)
+        return;
+
+    // The TIA output swings from the internal zero to the rail on one side and to ground on the other,
+    // a differential reading is that swing already
+    float volts = _raw * (adsMaxVoltageFromGain(type.adsGain) / 32767.0F);
+    float zero = REF_VOLTAGE * (internalZeroPercent / 100.0F);
+    float signal = differential ? volts : volts - zero;
+    float swing = fabs(signal);
+    float room = signal >= 0 ? LMP_SUPPLY_VOLTAGE - zero : zero;
+    float gain = tiaGainFromCode(type.TIA_GAIN_IN_KOHMS);
+
+    uint8_t tia = type.TIA_GAIN_IN_KOHMS;
+    if (swing > AUTORANGE_TIA_HIGH * room)
+    {
+        // Go down to where it's well clear of the rail, at least one step. A clipped reading understates
+        // the swing, the readings after the settling time go further down if needed
+        while (tia > TIA_GAIN_2_75_KOHM &&
+               (tia == type.TIA_GAIN_IN_KOHMS || swing * tiaGainFromCode(tia) / gain > AUTORANGE_TIA_LOW * room))
+            tia--;
+    }
+    else if (tia < TIA_GAIN_350_KOHM && swing * tiaGainFromCode(tia + 1) / gain < AUTORANGE_TIA_LOW * room)
+    {
+        tia++;
+    }
+    rangeTiaGain = tia;
+}
+
+// Switch to the range picked by autoRangeCheck()
+void ElectrochemicalGasSensor::autoRangeApply()
+{
+    if (ads == nullptr || (rangeAdsGain == type.adsGain && rangeTiaGain == type.TIA_GAIN_IN_KOHMS))
+        return;
+
+    uint8_t oldAdsGain = type.adsGain;
+    uint8_t oldTiaGain = type.TIA_GAIN_IN_KOHMS;
+    bool tiaChanged = rangeTiaGain != oldTiaGain;
+    type.adsGain = rangeAdsGain;
+    type.TIA_GAIN_IN_KOHMS = rangeTiaGain;
+
+    bool ok = true;
+    if (mode == TransportMode::LEGACY_DIRECT)
+    {
+        // The PGA is in the config which every single-shot conversion writes anyway
+        if (tiaChanged)
+            ok = writeLmpConfig(lmpModecn(type));
+    }
+    else // TransportMode::BRIDGE
+    {
+        ok = sendConfigureAll(type.adsGain, dataRate, lmpTiacn(type), lmpRefcn(type), lmpModecn(type));
+        // Bridge firmware without CMD_CONFIGURE_ALL answers with an error, use the separate commands then
+        if (!ok && bridgeLastStatus == BRIDGE_STATUS_ERROR)
+            ok = sendConfigureAdc(type.adsGain, dataRate) &&
+                 (!tiaChanged || sendConfigureLmp(lmpTiacn(type), lmpRefcn(type), lmpModecn(type)));
+    }
+
+    // Stay in the old range if the front end didn't take the new one, the next reading tries again
+    if (!ok)
+    {
+        type.adsGain = oldAdsGain;
+        type.TIA_GAIN_IN_KOHMS = oldTiaGain;
+        rangeAdsGain = oldAdsGain;
+        rangeTiaGain = oldTiaGain;
+    }
+
+    ads->setGain(type.adsGain);
+    // A PGA step only changes the LSB, keep the TIA gain, it may come from setCustomTiaGain()
+    if (type.TIA_GAIN_IN_KOHMS != oldTiaGain && type.TIA_GAIN_IN_KOHMS != TIA_GAIN_EXTERNAL)
+        tiaGainInKOHms = getTiaGain();
+    updateConversion();
+
+    // The PGA needs no settling, the next single-shot conversion is already made in the new range
+    if (ok && tiaChanged)
+    {
+        autoRangeSettling = true;
+        autoRangeChangeMs = millis();
+    }
+}
+
+/**
+ * @brief                   Measure VOUT against the internal zero of the LMP91000 instead of ground
+ *
+ * @note                    Only for legacy boards which have the internal zero (C1) wired to AIN1 of the ADS1115.
+ *                          The ADS1115 then subtracts the zero in hardware, so drift of the reference and
+ *                          the internal zero divider doesn't show up as gas, and the PGA can use a smaller
+ *                          range because the reading doesn't carry the zero voltage. Call before begin().
+ *
+ * @param bool _differential    True if the board has the zero wired to AIN1
+ *
+ * @returns                 True if it was set, false if the board can't do it (bridge boards, cells not on AIN0)
+ *
+ */
+bool ElectrochemicalGasSensor::setDifferential(bool _differential)
+{
+    // AIN1 is the zero, so only the cell on AIN0 can use it
+    if ((adcAddr >= BRIDGE_ADDR_MIN && adcAddr <= BRIDGE_ADDR_MAX) || channel != 0)
+        return false;
+
+    differential = _differential;
+    updateConversion();
+    return true;
+}
+
+/**
+ * @brief                   Check if VOUT is measured against the internal zero, see setDifferential()
+ *
+ * @returns                 True if it's measured differentially
+ *
+ */
+bool ElectrochemicalGasSensor::isDifferential()
+{
+    return differential;
+}
+
+/**
+ * @brief                   Get the ADS1115 input of the cell
+ *
+ * @returns                 0 to 3, 0 unless it shares the ADS1115 of another cell
+ *
+ */
+uint8_t ElectrochemicalGasSensor::getChannel()
+{
+    return channel;
+}
+
+/**
+ * @brief                   Throw away the first conversion after the ADS1115 mux switched to this cell
+ *
+ * @note                    A single-shot conversion of the ADS1115 settles on its own, this is only needed
+ *                          when the inputs are filtered and take longer to follow a switch. It costs one
+ *                          conversion time, and only when the mux actually moved since the last conversion,
+ *                          so a cell which has the ADS1115 to itself is only affected after a temperature reading.
+ *
+ * @param bool _discard     True to throw away the first conversion, disabled by default
+ *
+ */
+void ElectrochemicalGasSensor::setDiscardAfterSwitch(bool _discard)
+{
+    discardAfterSwitch = _discard;
+}
+
+// The sensor which keeps track of the ADS1115 this one converts on
+ElectrochemicalGasSensor *ElectrochemicalGasSensor::adcHost()
+{
+    return adcOwner != nullptr ? adcOwner : this;
+}
+
+// Point the legacy ADS1115 at this cell, true if the mux has to switch for it
+bool ElectrochemicalGasSensor::selectSignal()
+{
+    // A shared ADS1115 may be set up for another cell, the settings are sent with the next conversion anyway
+    ads->setGain(type.adsGain);
+    ads->setDataRate(dataRate);
+
+    uint8_t mux = differential ? ADS_MUX_DIFFERENTIAL : channel;
+    ElectrochemicalGasSensor *host = adcHost();
+    bool switched = host->adsMux != mux;
+    host->adsMux = mux;
+    return switched;
+}
+
+// Start a conversion of the cell signal on the legacy ADS1115, in the mode set with setMode()
+void ElectrochemicalGasSensor::requestSignal()
+{
+    if (differential)
+        ads->requestADC_Differential_0_1();
+    else
+        ads->requestADC(channel);
+}
+
+// Make a single-shot conversion of the cell signal on the legacy ADS1115
+int16_t ElectrochemicalGasSensor::readSignal()
+{
+    if (differential)
+        return ads->readADC_Differential_0_1();
+    return ads->readADC(channel);
+}
+
+// Write the config with this operating mode to the LMP91000 of a legacy board, the driver only sends what changed
+bool ElectrochemicalGasSensor::writeLmpConfig(uint8_t _modecn)
+{
+    if (configPin != -1)
+        digitalWrite(configPin, LOW);
+
+    bool ok = lmp->configure(lmpTiacnValue(), lmpRefcnValue(), _modecn);
+
+    if (configPin != -1)
+        digitalWrite(configPin, HIGH);
+    return ok;
+}
+
+/**
+ * @brief                   Send a command to the ATtiny bridge and poll the 3-byte response
+ *
+ * @note                    Blocking - protocol is synchronous, one command in flight at a time.
+ *                          Only used when mode == TransportMode::BRIDGE.
+ *
+ * @returns                 True if the bridge answered OK before the timeout, false on error/timeout
+ *                          or if the command wasn't acknowledged
+ *
+ */
+bool ElectrochemicalGasSensor::bridgeTransaction(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                                  uint8_t *resultHigh, uint8_t *resultLow)
+{
+    unsigned long start = micros();
+    bool sent = bridgeSendCommand(cmd, payload, payloadLen);
+    bridgeStats.transactions++;
+
+    // Nobody took the command, there's nothing to wait for
+    if (!sent)
+    {
+        bridgeLastStatus = BRIDGE_STATUS_NONE;
+        return false;
+    }
+
+    // Don't touch the bus until the command should be done
+    unsigned long expectedUs = bridgeExpectedLatencyUs(cmd);
+    if (expectedUs >= 1000)
+        delay(expectedUs / 1000);
+    delayMicroseconds(expectedUs % 1000);
+
+    // Then poll with exponential backoff
+    unsigned long backoffUs = BRIDGE_POLL_MIN_US;
+    while (micros() - start < BRIDGE_TIMEOUT_MS * 1000UL)
+    {
+        uint8_t status = bridgePollResponse(resultHigh, resultLow);
+        bridgeStats.polls++;
+        bridgeLastStatus = status;
+        if (status == BRIDGE_STATUS_OK)
+        {
+            recordBridgeLatency(micros() - start);
+            return true;
+        }
+        if (status == BRIDGE_STATUS_ERROR)
+        {
+            bridgeStats.errors++;
+            recordBridgeLatency(micros() - start);
+            return false;
+        }
+
+        // Still BUSY, no command registered yet or a short read - wait and retry
+        SENSOR_STATS_COUNT(stats.bridgeBusyRetries);
+        if (backoffUs >= 1000)
+            delay(backoffUs / 1000);
+        else
+            delayMicroseconds(backoffUs);
+        if (backoffUs < BRIDGE_POLL_MAX_US)
+            backoffUs *= 2;
+    }
+    bridgeLastStatus = BRIDGE_STATUS_NONE;
+    bridgeStats.timeouts++;
+    SENSOR_STATS_COUNT(stats.bridgeTimeouts);
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    recordLatency(stats.bridgeTransaction, micros() - start);
+#endif
+    return false; // timeout
+}
+
+/**
+ * @brief                   How long the bridge should need for a command, before it's worth polling it
+ *
+ * @returns                 Expected latency in microseconds
+ *
+ */
+unsigned long ElectrochemicalGasSensor::bridgeExpectedLatencyUs(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case CMD_TRIGGER_ADC:
+    case CMD_CONFIGURE_AND_TRIGGER:
+        // One single-shot conversion at the configured data rate
+        return conversionTimeUs();
+    default:
+        // Only register writes on the bridge side
+        return BRIDGE_POLL_MIN_US;
+    }
+}
+
+/**
+ * @brief                   How long one ADS1115 conversion takes at the current data rate
+ *
+ * @returns                 Conversion time in microseconds
+ *
+ */
+unsigned long ElectrochemicalGasSensor::conversionTimeUs()
+{
+    // ADS1115 samples per second for each data rate setting
+    static const uint16_t samplesPerSecond[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return 1000000UL / samplesPerSecond[dataRate & 0x07];
+}
+
+/**
+ * @brief                   Add a finished transaction to the bridge statistics
+ *
+ */
+void ElectrochemicalGasSensor::recordBridgeLatency(unsigned long latencyUs)
+{
+    bridgeStats.lastLatencyUs = latencyUs;
+    bridgeStats.totalLatencyUs += latencyUs;
+    if (latencyUs > bridgeStats.maxLatencyUs)
+        bridgeStats.maxLatencyUs = latencyUs;
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    recordLatency(stats.bridgeTransaction, latencyUs);
+#endif
+}
+
+/**
+ * @brief                   Start polling a split-phase command which was just sent with bridgeSendCommand()
+ *
+ * @note                    Polled from isConfigureDone() and isMeasurementReady() with bridgeSplitPoll()
+ *
+ */
+void ElectrochemicalGasSensor::bridgeSplitStart(uint8_t cmd)
+{
+    bridgeStats.transactions++;
+    splitStartUs = micros();
+    // Don't touch the bus until the command should be done
+    splitNextPollUs = bridgeExpectedLatencyUs(cmd);
+    splitBackoffUs = BRIDGE_POLL_MIN_US;
+}
+
+/**
+ * @brief                   Poll the split-phase command once, if it's time to, see bridgeTransaction()
+ *
+ * @note                    Doesn't wait. The polls back off exponentially like in bridgeTransaction(),
+ *                          so calling this in a tight loop doesn't keep a slow bridge busy answering them.
+ *
+ * @returns                 BRIDGE_STATUS_OK or BRIDGE_STATUS_ERROR when done, BRIDGE_STATUS_BUSY if not yet,
+ *                          BRIDGE_STATUS_NONE on timeout
+ *
+ */
+uint8_t ElectrochemicalGasSensor::bridgeSplitPoll(uint8_t *resultHigh, uint8_t *resultLow)
+{
+    if (micros() - splitStartUs < splitNextPollUs)
+        return BRIDGE_STATUS_BUSY;
+
+    uint8_t status = bridgePollResponse(resultHigh, resultLow);
+    bridgeStats.polls++;
+    bridgeLastStatus = status;
+    if (status == BRIDGE_STATUS_OK)
+    {
+        recordBridgeLatency(micros() - splitStartUs);
+        return status;
+    }
+    if (status == BRIDGE_STATUS_ERROR)
+    {
+        bridgeStats.errors++;
+        recordBridgeLatency(micros() - splitStartUs);
+        return status;
+    }
+
+    unsigned long elapsedUs = micros() - splitStartUs;
+    if (elapsedUs >= BRIDGE_TIMEOUT_MS * 1000UL)
+    {
+        bridgeLastStatus = BRIDGE_STATUS_NONE;
+        bridgeStats.timeouts++;
+        SENSOR_STATS_COUNT(stats.bridgeTimeouts);
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+        recordLatency(stats.bridgeTransaction, elapsedUs);
+#endif
+        return BRIDGE_STATUS_NONE;
+    }
+
+    // Still BUSY, no command registered yet or a short read - poll again after the backoff
+    SENSOR_STATS_COUNT(stats.bridgeBusyRetries);
+    splitNextPollUs = elapsedUs + splitBackoffUs;
+    if (splitBackoffUs < BRIDGE_POLL_MAX_US)
+        splitBackoffUs *= 2;
+    return BRIDGE_STATUS_BUSY;
+}
+
+/**
+ * @brief                   Get the statistics of the bridge transactions since begin() or resetBridgeStats()
+ *
+ * @note                    The split-phase requestConfigure()/requestMeasurement() are counted too,
+ *                          the streaming reads are not
+ *
+ * @returns                 The statistics, average latency is totalLatencyUs / (transactions - timeouts)
+ *
+ */
+BridgeStats ElectrochemicalGasSensor::getBridgeStats()
+{
+    return bridgeStats;
+}
+
+/**
+ * @brief                   Clear the bridge transaction statistics
+ *
+ */
+void ElectrochemicalGasSensor::resetBridgeStats()
+{
+    memset(&bridgeStats, 0, sizeof(bridgeStats));
+}
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+/**
+ * @brief                   Get the I2C counters and latency statistics since begin() or resetStats()
+ *
+ * @note                    Only available with ELECTROCHEMICAL_SENSOR_STATS, see ElectrochemicalSensorStats.h
+ *
+ * @returns                 The statistics, copy them out periodically and call resetStats() for windowed values
+ *
+ */
+SensorStats ElectrochemicalGasSensor::getStats()
+{
+    return stats;
+}
+
+/**
+ * @brief                   Clear the I2C counters and latency statistics
+ *
+ */
+void ElectrochemicalGasSensor::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+#endif
+
+/**
+ * @brief                   Write a command and its payload to the ATtiny bridge without waiting for the response
+ *
+ * @returns                 True if the bridge ACKed the write
+ *
+ */
+bool ElectrochemicalGasSensor::bridgeSendCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen)
+{
+    wire->beginTransmission(adcAddr);
+    wire->write(cmd);
+    for (uint8_t i = 0; i < payloadLen; i++)
+        wire->write(payload[i]);
+    bool ok = wire->endTransmission() == 0;
+    I2C_COUNT_WRITE(&stats.i2c, 1 + payloadLen, ok);
+    return ok;
+}
+
+/**
+ * @brief                   Read the 3-byte response of the ATtiny bridge once
+ *
+ * @note                    resultHigh/resultLow are only written when the status is BRIDGE_STATUS_OK
+ *
+ * @returns                 The status byte, or BRIDGE_STATUS_NONE if fewer than 3 bytes came back
+ *
+ */
+uint8_t ElectrochemicalGasSensor::bridgePollResponse(uint8_t *resultHigh, uint8_t *resultLow)
+{
+    uint8_t received = wire->requestFrom(adcAddr, (uint8_t)3);
+    I2C_COUNT_READ(&stats.i2c, 3, received);
+    if (received < 3 || wire->available() < 3)
+        return BRIDGE_STATUS_NONE;
+
+    uint8_t status = wire->read();
+    uint8_t hi = wire->read();
+    uint8_t lo = wire->read();
+
+    if (status == BRIDGE_STATUS_OK)
+    {
+        if (resultHigh)
+            *resultHigh = hi;
+        if (resultLow)
+            *resultLow = lo;
+    }
+    return status;
+}
+
+bool ElectrochemicalGasSensor::pingBridge()
+{
+    return bridgeTransaction(CMD_PING, nullptr, 0, nullptr, nullptr);
+}
+
+bool ElectrochemicalGasSensor::sendConfigureAdc(uint8_t gain, uint8_t dataRate)
+{
+    uint8_t payload[2] = {gain, dataRate};
+    return bridgeTransaction(CMD_CONFIGURE_ADC, payload, 2, nullptr, nullptr);
+}
+
+bool ElectrochemicalGasSensor::sendConfigureLmp(uint8_t tiacn, uint8_t refcn, uint8_t modecn)
+{
+    uint8_t payload[3] = {tiacn, refcn, modecn};
+    return bridgeTransaction(CMD_CONFIGURE_LMP, payload, 3, nullptr, nullptr);
+}
+
+/**
+ * @brief                   Read the samples the ATtiny bridge has collected since the last read, in one burst
+ *
+ * @note                    Only for bridge boards in streaming mode, see startStreaming().
+ *                          The response is a status byte, a count byte and count x 2 bytes of samples.
+ *
+ * @param int16_t *_buf     Where to copy the samples
+ *
+ * @param uint8_t _n        Maximum number of samples to read, at most BRIDGE_STREAM_MAX_BURST
+ *
+ * @returns                 Number of samples read
+ *
+ */
+uint8_t ElectrochemicalGasSensor::readBridgeSamples(int16_t *_buf, uint8_t _n)
+{
+    if (mode != TransportMode::BRIDGE || !streaming)
+        return 0;
+
+    if (_n > BRIDGE_STREAM_MAX_BURST)
+        _n = BRIDGE_STREAM_MAX_BURST;
+
+    uint8_t payload[1] = {_n};
+    if (!bridgeSendCommand(CMD_READ_STREAM, payload, 1))
+        return 0;
+
+    uint8_t len = 2 + 2 * _n;
+    uint8_t received = wire->requestFrom(adcAddr, len);
+    I2C_COUNT_READ(&stats.i2c, len, received);
+    if (received < 2)
+        return 0;
+
+    uint8_t status = wire->read();
+    uint8_t count = wire->read();
+    if (status != BRIDGE_STATUS_OK)
+        return 0;
+
+    // Never trust the count over what actually came in
+    if (count > _n)
+        count = _n;
+    if (count > (received - 2) / 2)
+        count = (received - 2) / 2;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t hi = wire->read();
+        uint8_t lo = wire->read();
+        _buf[i] = (int16_t)(((uint16_t)hi << 8) | lo);
+    }
+    return count;
+}
+
+// Batched configuration: the ADC and LMP config in one transaction instead of ping + 2 configure commands
+bool ElectrochemicalGasSensor::sendConfigureAll(uint8_t gain, uint8_t dataRate, uint8_t tiacn, uint8_t refcn,
+                                                uint8_t modecn, uint8_t *resultHigh)
+{
+    uint8_t payload[5] = {gain, dataRate, tiacn, refcn, modecn};
+    return bridgeTransaction(CMD_CONFIGURE_ALL, payload, 5, resultHigh, nullptr);
+}
+
+// Same as sendConfigureAll() followed by triggerAndReadAdc(), in one transaction
+bool ElectrochemicalGasSensor::configureAndReadAdc(uint8_t gain, uint8_t tiacn, uint8_t refcn, uint8_t modecn,
+                                                   int16_t &rawOut)
+{
+    uint8_t payload[5] = {gain, dataRate, tiacn, refcn, modecn};
+    uint8_t hi = 0, lo = 0;
+    bool ok = bridgeTransaction(CMD_CONFIGURE_AND_TRIGGER, payload, 5, &hi, &lo);
+    rawOut = (int16_t)(((uint16_t)hi << 8) | lo);
+    return ok;
 }
 
 bool ElectrochemicalGasSensor::triggerAndReadAdc(int16_t &rawOut)
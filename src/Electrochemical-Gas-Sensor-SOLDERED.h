@@ -16,7 +16,11 @@
 // Useful when calibrating the sensor
 //#define ELECTROCHEMICAL_SENSOR_DEBUG
 
+// I2C counters and latency statistics are enabled with ELECTROCHEMICAL_SENSOR_STATS,
+// which is in ElectrochemicalSensorStats.h because the drivers have to see it too
+
 #include "Arduino.h"
+#include "ElectrochemicalSensorStats.h"
 #include "libs/ADS1X15/ADS1X15.h"
 #include "libs/LMP91000/LMP91000.h"
 #include "sensorConfigData.h"
@@ -33,6 +37,19 @@
 #define CMD_CONFIGURE_ADC 0x02
 #define CMD_CONFIGURE_LMP 0x03
 #define CMD_TRIGGER_ADC   0x04
+// Batched commands, payload: gain, data rate, tiacn, refcn, modecn
+// CMD_CONFIGURE_ALL answers OK once both the ADC and the LMP are configured,
+// CMD_CONFIGURE_AND_TRIGGER also makes a conversion and answers with the result like CMD_TRIGGER_ADC
+#define CMD_CONFIGURE_ALL         0x05
+#define CMD_CONFIGURE_AND_TRIGGER 0x06
+// High result byte of a CMD_CONFIGURE_ALL answer when the bridge already had this config and left the
+// ADC and LMP alone (warm restart of the host), older firmware always answers 0
+#define BRIDGE_CONFIG_UNCHANGED 0x01
+// Streaming: CMD_START_STREAM (payload: data rate) makes the ATtiny sample continuously into a FIFO,
+// CMD_READ_STREAM (payload: max samples) is answered with status, count and count x 2 bytes of samples
+#define CMD_START_STREAM 0x07
+#define CMD_STOP_STREAM  0x08
+#define CMD_READ_STREAM  0x09
 
 #define BRIDGE_STATUS_BUSY  0x00
 #define BRIDGE_STATUS_OK    0x01
@@ -46,7 +63,105 @@
 #define BRIDGE_ADDR_MAX   0x37
 #define BRIDGE_TIMEOUT_MS 500
 
-// LEGACY_DIRECT: direct-wired board, talk to LMP91000/ADS1115 over Wire as before.
+// Polling backoff in bridgeTransaction(): first retry after BRIDGE_POLL_MIN_US, doubling up to BRIDGE_POLL_MAX_US
+#define BRIDGE_POLL_MIN_US 250
+#define BRIDGE_POLL_MAX_US 8000
+
+// A legacy single-shot conversion which isn't done after this many conversion times plus the margin failed,
+// e.g. the board was unplugged. The ADS1115 data rate is only accurate to 10%
+#define ADS_TIMEOUT_CONVERSIONS 2
+#define ADS_TIMEOUT_MARGIN_US   1000
+// A legacy conversion which isn't done at the expected time is checked again this often
+#define ADS_POLL_INTERVAL_US 250
+
+// Most samples read in one CMD_READ_STREAM burst, 2 + 15 x 2 bytes fits the 32 byte Wire buffer
+#define BRIDGE_STREAM_MAX_BURST 15
+
+// Size of the ring buffer used by the streaming mode, in samples
+// Must be a power of 2 and at most 128 so the indexes can be updated atomically on 8-bit MCUs
+#ifndef STREAM_BUFFER_SIZE
+#define STREAM_BUFFER_SIZE 32
+#endif
+#if (STREAM_BUFFER_SIZE & (STREAM_BUFFER_SIZE - 1)) != 0 || STREAM_BUFFER_SIZE > 128
+#error "STREAM_BUFFER_SIZE must be a power of 2 and at most 128"
+#endif
+
+// How many sensors can use the ALERT/RDY interrupt at the same time
+#define RDY_MAX_SENSORS 4
+
+// LMP91000 temperature sensor, VOUT in mV = LMP_TEMPERATURE_MV_AT_0C + LMP_TEMPERATURE_MV_PER_C * degrees C
+// A linear fit of the transfer table in the datasheet, within about 1 degree from -40 to 85
+#define LMP_TEMPERATURE_MV_AT_0C 1555.0F
+#define LMP_TEMPERATURE_MV_PER_C -8.0F
+
+// VOUT stays below 2V down to -50 degrees, so the temperature is read at the 2.048V range
+#define TEMPERATURE_ADS_GAIN ADS_GAIN_2_048V
+
+// Time for VOUT to follow the switch to the temperature sensor on legacy boards
+#ifndef TEMPERATURE_SETTLING_MS
+#define TEMPERATURE_SETTLING_MS 10
+#endif
+
+// getTemperature() before the first successful measureTemperature()
+#define TEMPERATURE_INVALID -273.15F
+
+// Auto-ranging modes, see setAutoRange()
+#define AUTORANGE_OFF     0
+#define AUTORANGE_PGA     1 // only the ADS1115 PGA
+#define AUTORANGE_PGA_TIA 2 // the PGA first, the LMP91000 TIA gain when the PGA can't help
+
+// The PGA steps to a bigger range at this code, and to a smaller one when the reading would be below
+// AUTORANGE_PGA_LOW of the smaller range. The gap between the two is the hysteresis.
+#define AUTORANGE_PGA_HIGH_CODE 30000
+#define AUTORANGE_PGA_LOW       0.75F
+
+// The TIA gain steps down when its output is above AUTORANGE_TIA_HIGH of the way from the internal zero
+// to the rail, to a gain which puts it below AUTORANGE_TIA_LOW. It steps up if it stays below that after the step.
+#define AUTORANGE_TIA_HIGH 0.9F
+#define AUTORANGE_TIA_LOW  0.5F
+
+// No range changes for this long after a TIA gain change, the cell current needs time to settle
+#ifndef AUTORANGE_TIA_SETTLING_MS
+#define AUTORANGE_TIA_SETTLING_MS 2000
+#endif
+
+// What the ADS1115 mux was last set to by a sensor, see selectSignal(): the input 0-3 of a single-ended reading,
+// ADS_MUX_DIFFERENTIAL for AIN0 - AIN1 or ADS_MUX_UNKNOWN when it has to be assumed switched
+#define ADS_MUX_DIFFERENTIAL 4
+#define ADS_MUX_UNKNOWN      0xFF
+
+// Supply of the LMP91000, where the TIA output clips
+#ifndef LMP_SUPPLY_VOLTAGE
+#define LMP_SUPPLY_VOLTAGE 3.3F
+#endif
+
+class GasSampleFilter;
+
+// Statistics of the ATtiny bridge transactions, see getBridgeStats()
+struct BridgeStats
+{
+    uint32_t transactions;   // commands sent
+    uint32_t polls;          // 3-byte status reads, including the final one
+    uint32_t errors;         // answered with BRIDGE_STATUS_ERROR
+    uint32_t timeouts;       // no answer within BRIDGE_TIMEOUT_MS
+    uint32_t lastLatencyUs;  // from the command write to the final status read
+    uint32_t maxLatencyUs;
+    uint32_t totalLatencyUs; // of all transactions which didn't time out
+};
+
+// What ElectrochemicalGasSensorT computes at compile time, used by the base class instead of its runtime switches
+struct compiledSensorConfig
+{
+    uint8_t tiacn;
+    uint8_t refcn;
+    uint8_t modecn;
+    float tiaGain;             // in Ohms
+    float internalZeroPercent;
+    double ppmSlope;           // ppm = raw * ppmSlope + ppmOffset, before the temperature compensation
+    double ppmOffset;
+};
+
+// LEGACY_DIRECT: direct-wired board, talk to LMP91000/ADS1115 over I2C as before.
 // BRIDGE: new ATtiny404 board revision, talk to the ATtiny's command protocol instead.
 enum class TransportMode
 {
@@ -61,18 +176,125 @@ class ElectrochemicalGasSensor
     //  - legacy direct-wired boards: the ADS1115's own I2C address (0x48-0x4B)
     //  - ATtiny bridge boards: the bridge's easyC jumper address (0x30-0x37)
     // begin() auto-detects which one applies from the address range.
-    ElectrochemicalGasSensor(sensorType _t, uint8_t _adcAddr = DEFAULT_ADC_ADDR, int _configPin = -1);
-    bool begin();
+    // _wire selects the I2C bus, all the traffic of this sensor (ADS1115, LMP91000 and bridge) goes through it.
+    ElectrochemicalGasSensor(sensorType _t, uint8_t _adcAddr = DEFAULT_ADC_ADDR, int _configPin = -1,
+                             TwoWire *_wire = &Wire);
+    // Multi-cell carrier boards (legacy only): a cell whose LMP91000 VOUT is on input _channel (1 to 3) of the
+    // ADS1115 of _adcOwner, the cell on AIN0. Each cell needs its own configPin on the LMP91000's MENB.
+    ElectrochemicalGasSensor(sensorType _t, ElectrochemicalGasSensor &_adcOwner, uint8_t _channel, int _configPin);
+    // _configureLMP = false skips the front end configuration, for an LMPConfigManager or requestConfigure()
+    // The drivers are members, so begin() can be called again and nothing is ever allocated
+    bool begin(bool _configureLMP = true);
+    void end();
     bool configureLMP();
+
+    // Split-phase configureLMP(), so many bridge boards can be configured at the same time:
+    // requestConfigure() sends the config, isConfigureDone() checks on it without waiting.
+    // Legacy boards are configured right away in requestConfigure().
+    bool requestConfigure();
+    bool isConfigureDone();
+    bool isConfigured();
+
+    // Warm start: before configuring a legacy board, read its LMP91000 back and leave it alone if it
+    // already has the config, e.g. after a reset of the MCU only. Bridge boards report this on their own.
+    void setWarmStart(bool _warmStart);
+    bool isWarmStarted();
     double getVoltage();
+    int16_t getRaw();
     double getPPM();
     double getPPB();
+    // Integer-only PPB conversion for MCUs without an FPU
+    int32_t getPPBInt();
+    int32_t getRawScaled(int16_t _raw);
+    // Measure through a GasSampleFilter until it emits a sample, see GasSampleFilter.h
+    double getFilteredPPM(GasSampleFilter &_filter);
+    double filteredRawToPPM(float _raw);
     double getAveragedPPM(uint8_t _numMeasurements = 5, uint8_t _secondsDelay = 2);
     double getAveragedPPB(uint8_t _numMeasurements = 5, uint8_t _secondsDelay = 2);
+
+    // Non-blocking alternative to getAveragedPPM(): call startAveraging() once, then
+    // call poll() from loop() until isAveragingDone() returns true. Failed measurements are
+    // left out of the average, getAverageResult() is -1 if all of them failed.
+    void startAveraging(uint8_t _numMeasurements = 5, unsigned long _intervalMs = 2000);
+    bool poll();
+    bool isAveragingDone();
+    double getAverageResult();
+
+    // Split-phase measurement: requestMeasurement() starts a conversion, isMeasurementReady()
+    // checks on it without waiting and readPPM() converts the result.
+    bool requestMeasurement();
+    bool isMeasurementReady();
+    double readPPM();
+
+    // ADS1115 data rate, 0 (8 SPS, default) to 7 (860 SPS) - see ADS1X15::setDataRate()
+    void setDataRate(uint8_t _dataRate);
+    uint8_t getDataRate();
+
+    // Streaming mode: the ADS1115 converts continuously and updateStreaming() reads only the
+    // conversion register (or the bridge's FIFO) into a ring buffer, which is drained with readSamples()
+    bool startStreaming(uint8_t _dataRate = 7);
+    // Same as startStreaming(), but a sample is only read after the ADS1115 signals it on ALERT/RDY
+    bool startInterruptStreaming(uint8_t _rdyPin, uint8_t _dataRate = 7);
+    void stopStreaming();
+    bool isStreaming();
+    bool updateStreaming();
+    uint8_t availableSamples();
+    uint8_t readSamples(int16_t *_buf, uint8_t _n);
+    uint8_t readBridgeSamples(int16_t *_buf, uint8_t _n);
+    BridgeStats getBridgeStats();
+    void resetBridgeStats();
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    SensorStats getStats();
+    void resetStats();
+#endif
+    uint16_t getStreamOverruns();
+    double rawToPPM(int16_t _raw);
+
+    // Hardware gas alarm: the ADS1115 window comparator latches ALERT/RDY when the
+    // concentration leaves the [_lowPpm, _highPpm] range, so the MCU can sleep meanwhile
+    bool setAlarmThresholdsPPM(double _lowPpm, double _highPpm, uint8_t _conversions = 1);
+    double clearAlarm();
+    void disableAlarm();
+    int16_t ppmToRaw(double _ppm);
     void setCustomTiaGain(float _tiaGain);
     void setCustomZeroCalibration(double calibration);
 
+    // On-chip temperature: measureTemperature() switches the LMP91000 to its temperature sensor for one
+    // reading and back. With setTemperatureInterval(N) every N-th blocking measurement does this first, and the
+    // PPM conversion is compensated with the curve from setTemperatureCurve() at the last temperature.
+    // The library has no curves of its own, take them from the datasheet of the cell.
+    bool measureTemperature();
+    float getTemperature();
+    void setTemperatureInterval(uint8_t _interval);
+    void setTemperatureCurve(const temperatureCurve *_curve);
+
+    // Auto-ranging: the PGA and TIA gain follow the signal, for the best resolution which doesn't clip
+    void setAutoRange(uint8_t _mode);
+    uint8_t getAdsGain();
+    uint8_t getTiaGainCode();
+
+    // Board option: the internal zero of the LMP91000 is wired to AIN1 and VOUT is measured against it
+    bool setDifferential(bool _differential);
+    bool isDifferential();
+
+    // ADS1115 input of the cell, 0 unless it shares the ADS1115 of another cell
+    uint8_t getChannel();
+    // Throw away the first conversion after the ADS1115 mux switched to this cell, for inputs which need time
+    void setDiscardAfterSwitch(bool _discard);
+
+  protected:
+    // For ElectrochemicalGasSensorT, _compiled has to outlive the sensor
+    ElectrochemicalGasSensor(const compiledSensorConfig &_compiled, sensorType _t, uint8_t _adcAddr, int _configPin,
+                             TwoWire *_wire);
+
   private:
+    friend class LMPConfigManager;
+    friend class GasSensorArray;
+
+    TwoWire *wire;
+    // The drivers live in the object, lmp and ads point to them between begin() and end()
+    LMP91000 lmpDevice;
+    ADS1115 adsDevice;
     LMP91000 *lmp;
     ADS1115 *ads;
     uint8_t adcAddr;
@@ -80,17 +302,188 @@ class ElectrochemicalGasSensor
     sensorType type;
     TransportMode mode;
     float tiaGainInKOHms;
+    float customTiaGain; // from setCustomTiaGain(), kept for TIA_GAIN_EXTERNAL across begin(), -1 until set
     float internalZeroPercent;
     float getTiaGain();
     float getInternalZeroPercent();
+    void loadConfig();
+
+    // nullptr unless constructed by ElectrochemicalGasSensorT, then the config values come from there
+    const compiledSensorConfig *compiled;
+    uint8_t lmpTiacnValue();
+    uint8_t lmpRefcnValue();
+    uint8_t lmpModecnValue();
+
+    // VOUT is measured against the internal zero on AIN1 instead of ground, see setDifferential()
+    bool differential;
+    void requestSignal();
+    int16_t readSignal();
+
+    // Cells sharing one ADS1115 take turns, the one which owns it keeps track of the mux for all of them
+    ElectrochemicalGasSensor *adcOwner; // nullptr if the ADS1115 is this sensor's own
+    uint8_t channel;
+    bool adsShared; // set on the owner when another cell uses its ADS1115
+    uint8_t adsMux;
+    bool discardAfterSwitch;
+    ElectrochemicalGasSensor *adcHost();
+    bool selectSignal();
+
+    // Front end configuration state, see requestConfigure() and setWarmStart()
+    bool warmStart;
+    bool warmStarted;
+    bool bridgeConfigured;
+    bool configurePending;
+#ifdef ELECTROCHEMICAL_SENSOR_DEBUG
+    double voltageToPPM(double voltage);
+#endif
+
+    // Raw to PPM conversion, ppm = raw * ppmSlope + ppmOffset, cached by updateConversion()
+    double ppmSlope;
+    double ppmOffset;
+
+    // Fixed-point raw to PPB conversion: ppb = (raw * fixedScale + fixedOffset) >> fixedShift
+    int32_t fixedScale;
+    int32_t fixedOffset;
+    uint8_t fixedShift;
+    void updateConversion();
+
+    // Temperature compensation, the curve is only evaluated when the temperature changes and folded
+    // into ppmSlope and ppmOffset, so the compensated conversion costs the same as the plain one
+    const temperatureCurve *tempCurve;
+    float temperatureC;
+    uint8_t temperatureInterval;
+    uint8_t temperatureCountdown;
+    float compSensitivity; // of the cell at temperatureC, relative to the calibration
+    float compZeroPpm;     // what the cell reads in clean air at temperatureC
+    void updateCompensation();
+    void interleaveTemperature();
+    bool writeLmpConfig(uint8_t _modecn);
+
+    // Auto-ranging state, a reading only picks the range (rangeAdsGain, rangeTiaGain) and
+    // autoRangeApply() switches to it before the next measurement, see autoRangeCheck()
+    uint8_t autoRange;
+    uint8_t rangeAdsGain;
+    uint8_t rangeTiaGain;
+    bool autoRangeSettling;
+    unsigned long autoRangeChangeMs;
+    void autoRangeCheck(int16_t _raw);
+    void autoRangeApply();
+
+    // State of the non-blocking averaging started with startAveraging()
+    bool avgRunning;
+    uint8_t avgTarget;
+    uint8_t avgCount;    // measurements in avgSum
+    uint8_t avgAttempts; // measurements made, including the failed ones
+    double avgSum;
+    unsigned long avgIntervalMs;
+    unsigned long avgLastSampleMs;
+    bool avgStarted;
+    bool avgWaitingForResult;
+    bool avgAttempted();
+
+    // State of the measurement started with requestMeasurement()
+    bool measurementPending;
+    bool measurementFailed;
+    bool measurementDiscard; // the conversion in flight is the one thrown away after a mux switch
+    int16_t measurementRaw;
+    unsigned long measurementStartUs;    // only used in TransportMode::LEGACY_DIRECT for the polls and the timeout
+    unsigned long measurementNextPollUs; // since measurementStartUs
+
+    uint8_t dataRate;
+
+    // Streaming mode state, the ring buffer has a single producer and a single consumer
+    bool streaming;
+    uint8_t streamDataRateBefore; // the single-shot data rate, put back by stopStreaming()
+    unsigned long streamPeriodUs;
+    unsigned long streamLastUs;
+    int16_t streamBuffer[STREAM_BUFFER_SIZE];
+    volatile uint8_t streamHead;
+    volatile uint8_t streamTail;
+    volatile uint16_t streamOverruns;
+    void pushStreamSample(int16_t _raw);
+
+    // ALERT/RDY interrupt state, rdyPin is -1 when streaming is timed with micros() instead
+    bool alarmEnabled;
+
+    int rdyPin;
+    int8_t rdySlot;
+    volatile uint8_t rdyPending;
+    static ElectrochemicalGasSensor *rdyInstances[RDY_MAX_SENSORS];
+    static void rdyIsr0();
+    static void rdyIsr1();
+    static void rdyIsr2();
+    static void rdyIsr3();
+    void onRdy();
 
     // ATtiny bridge transport helpers - only used when mode == TransportMode::BRIDGE
     bool bridgeTransaction(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t *resultHigh,
                             uint8_t *resultLow);
+    bool bridgeSendCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen);
+    uint8_t bridgePollResponse(uint8_t *resultHigh, uint8_t *resultLow);
     bool pingBridge();
     bool sendConfigureAdc(uint8_t gain, uint8_t dataRate);
     bool sendConfigureLmp(uint8_t tiacn, uint8_t refcn, uint8_t modecn);
     bool triggerAndReadAdc(int16_t &rawOut);
+    bool sendConfigureAll(uint8_t gain, uint8_t dataRate, uint8_t tiacn, uint8_t refcn, uint8_t modecn,
+                          uint8_t *resultHigh = nullptr);
+    bool configureAndReadAdc(uint8_t gain, uint8_t tiacn, uint8_t refcn, uint8_t modecn, int16_t &rawOut);
+    uint8_t bridgeLastStatus; // status of the last bridgeTransaction(), BRIDGE_STATUS_NONE on timeout
+    BridgeStats bridgeStats;
+    unsigned long bridgeExpectedLatencyUs(uint8_t cmd);
+    unsigned long conversionTimeUs();
+    void recordBridgeLatency(unsigned long latencyUs);
+
+    // The command of requestConfigure()/requestMeasurement(), polled with the backoff of bridgeTransaction()
+    unsigned long splitStartUs;
+    unsigned long splitNextPollUs; // since splitStartUs
+    unsigned long splitBackoffUs;
+    void bridgeSplitStart(uint8_t cmd);
+    uint8_t bridgeSplitPoll(uint8_t *resultHigh, uint8_t *resultLow);
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    SensorStats stats;
+#endif
 };
 
+// Compile-time variant of ElectrochemicalGasSensor for a fixed sensor config, e.g.
+// ElectrochemicalGasSensorT<SENSOR_CO> sensor;
+// The LMP91000 register values, TIA gain and PPM conversion are computed by the compiler and used by
+// begin(), configureLMP() and all the readings of the base class, temperature compensation included
+// The config must be constexpr and can't be changed with setCustomTiaGain()/setCustomZeroCalibration()
+template <const sensorType &T> class ElectrochemicalGasSensorT : public ElectrochemicalGasSensor
+{
+  public:
+    static_assert(T.TIA_GAIN_IN_KOHMS != TIA_GAIN_EXTERNAL,
+                  "An external TIA gain has to be set with setCustomTiaGain(), use ElectrochemicalGasSensor");
+    static_assert(T.INTERNAL_ZERO != INTERNAL_ZERO_BYPASSED, "Bypassed internal zero is not supported");
+
+    static constexpr uint8_t TIACN = lmpTiacn(T);
+    static constexpr uint8_t REFCN = lmpRefcn(T);
+    static constexpr uint8_t MODECN = lmpModecn(T);
+    static constexpr float TIA_GAIN = tiaGainFromCode(T.TIA_GAIN_IN_KOHMS);
+
+    // ppm = raw * PPM_SLOPE + PPM_OFFSET, same as the runtime conversion in updateConversion()
+    static constexpr double VOLTS_PER_PPM = TIA_GAIN * (T.nanoAmperesPerPPM * (double)1e-9);
+    static constexpr double PPM_SLOPE = (adsMaxVoltageFromGain(T.adsGain) / 32767.0) / VOLTS_PER_PPM;
+    static constexpr double PPM_OFFSET =
+        (T.internalZeroCalibration - (REF_VOLTAGE * (internalZeroPercentFromCode(T.INTERNAL_ZERO) / 100.0F))) /
+        VOLTS_PER_PPM;
+
+    static constexpr compiledSensorConfig COMPILED = {
+        TIACN, REFCN, MODECN, TIA_GAIN, internalZeroPercentFromCode(T.INTERNAL_ZERO), PPM_SLOPE, PPM_OFFSET,
+    };
+
+    ElectrochemicalGasSensorT(uint8_t _adcAddr = DEFAULT_ADC_ADDR, int _configPin = -1, TwoWire *_wire = &Wire)
+        : ElectrochemicalGasSensor(COMPILED, T, _adcAddr, _configPin, _wire)
+    {
+    }
+
+    void setCustomTiaGain(float _tiaGain) = delete;
+    void setCustomZeroCalibration(double calibration) = delete;
+    void setAutoRange(uint8_t _mode) = delete;
+    bool setDifferential(bool _differential) = delete;
+};
+
+template <const sensorType &T> constexpr compiledSensorConfig ElectrochemicalGasSensorT<T>::COMPILED;
+
 #endif
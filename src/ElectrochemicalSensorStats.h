@@ -0,0 +1,102 @@
+/**
+ **************************************************
+ *
+ * @file        ElectrochemicalSensorStats.h
+ * @brief       Optional I2C traffic counters and latency statistics.
+ *
+ *              Shared by ElectrochemicalGasSensor and the ADS1X15/LMP91000 drivers, so the
+ *              switch below has to live here and not in the sketch.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __ELECTROCHEMICAL_SENSOR_STATS_SOLDERED__
+#define __ELECTROCHEMICAL_SENSOR_STATS_SOLDERED__
+
+// Uncomment this define (or pass -DELECTROCHEMICAL_SENSOR_STATS to the whole build) to count
+// the I2C traffic and time the sensor operations, see ElectrochemicalGasSensor::getStats()
+// When it's commented, all of the instrumentation is compiled out and costs nothing
+//#define ELECTROCHEMICAL_SENSOR_STATS
+
+#include "Arduino.h"
+
+// I2C transactions, a read which returns fewer bytes than requested is counted as a NACK
+struct I2CCounters
+{
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t bytes; // data bytes written and read, without the address byte
+    uint32_t nacks;
+};
+
+// Latency of one kind of operation, the average is totalUs / count
+struct LatencyStats
+{
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t totalUs;
+};
+
+struct SensorStats
+{
+    I2CCounters i2c;            // all the traffic of the sensor, including the drivers
+    uint32_t bridgeBusyRetries; // bridge polls which had to be repeated, BUSY or no answer
+    uint32_t bridgeTimeouts;
+    LatencyStats configureLMP;
+    LatencyStats measurement; // getRaw(), which getVoltage(), getPPM() and the others measure with
+    LatencyStats temperature; // measureTemperature(), including switching the LMP91000 there and back
+    LatencyStats bridgeTransaction;
+};
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+
+static inline void recordLatency(LatencyStats &_stats, uint32_t _us)
+{
+    if (_stats.count == 0 || _us < _stats.minUs)
+        _stats.minUs = _us;
+    if (_us > _stats.maxUs)
+        _stats.maxUs = _us;
+    _stats.totalUs += _us;
+    _stats.count++;
+}
+
+static inline void countI2CWrite(I2CCounters *_counters, uint32_t _len, bool _ok)
+{
+    if (!_counters)
+        return;
+    _counters->writes++;
+    _counters->bytes += _len;
+    if (!_ok)
+        _counters->nacks++;
+}
+
+static inline void countI2CRead(I2CCounters *_counters, uint32_t _requested, uint32_t _received)
+{
+    if (!_counters)
+        return;
+    _counters->reads++;
+    _counters->bytes += _received;
+    if (_received < _requested)
+        _counters->nacks++;
+}
+
+#define I2C_COUNT_WRITE(counters, len, ok)            countI2CWrite(counters, len, ok)
+#define I2C_COUNT_READ(counters, requested, received) countI2CRead(counters, requested, received)
+#define SENSOR_STATS_START()                          unsigned long statsStartUs = micros()
+#define SENSOR_STATS_RECORD(latency)                  recordLatency(latency, micros() - statsStartUs)
+#define SENSOR_STATS_COUNT(counter)                   (counter)++
+
+#else
+
+#define I2C_COUNT_WRITE(counters, len, ok)
+#define I2C_COUNT_READ(counters, requested, received)
+#define SENSOR_STATS_START()
+#define SENSOR_STATS_RECORD(latency)
+#define SENSOR_STATS_COUNT(counter)
+
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * **************************************************
+ *
+ * @file        GasSampleFilter.cpp
+ * @brief       Raw sample filter pipeline: median, boxcar with decimation and EMA.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#include "GasSampleFilter.h"
+
+/**
+ * @brief                   Constructor, all the filter stages are off
+ *
+ */
+GasSampleFilter::GasSampleFilter()
+{
+    medianSize = 1;
+    boxcarSize = 1;
+    emaAlpha = 1.0F;
+    reset();
+}
+
+/**
+ * @brief                   Set the size of the median window used to reject spikes
+ *
+ * @param uint8_t _n        Number of samples, 1 turns it off. Even values are rounded up,
+ *                          values larger than FILTER_MAX_MEDIAN are limited to it.
+ *
+ */
+void GasSampleFilter::setMedian(uint8_t _n)
+{
+    if (_n < 1)
+        _n = 1;
+    if ((_n & 1) == 0)
+        _n++;
+    if (_n > FILTER_MAX_MEDIAN)
+        _n = FILTER_MAX_MEDIAN;
+    medianSize = _n;
+    reset();
+}
+
+/**
+ * @brief                   Set how many samples are averaged into one output sample
+ *
+ * @note                    Averaging N samples lowers the noise by about sqrt(N), so use a faster
+ *                          ADC data rate to keep the same output rate
+ *
+ * @param uint16_t _n       Number of samples, 1 turns it off
+ *
+ */
+void GasSampleFilter::setDecimation(uint16_t _n)
+{
+    boxcarSize = (_n < 1) ? 1 : _n;
+    reset();
+}
+
+/**
+ * @brief                   Set the weight of the newest sample in the exponential moving average
+ *
+ * @param float _alpha      0 to 1, smaller is smoother, 1 turns it off
+ *
+ */
+void GasSampleFilter::setEMA(float _alpha)
+{
+    if (_alpha <= 0 || _alpha > 1)
+        _alpha = 1.0F;
+    emaAlpha = _alpha;
+    reset();
+}
+
+/**
+ * @brief                   Clear all the samples in the filter, the settings are kept
+ *
+ */
+void GasSampleFilter::reset()
+{
+    medianFill = 0;
+    medianPos = 0;
+    boxcarSum = 0;
+    boxcarCount = 0;
+    emaStarted = false;
+    value = 0;
+}
+
+/**
+ * @brief                   Feed a raw ADC reading into the filter
+ *
+ * @param int16_t _raw      Raw reading, e.g. from getRaw() or readSamples()
+ *
+ * @returns                 True if a new output sample is ready in getValue()
+ *
+ */
+bool GasSampleFilter::push(int16_t _raw)
+{
+    boxcarSum += median(_raw);
+    if (++boxcarCount < boxcarSize)
+        return false;
+
+    float decimated = (float)boxcarSum / boxcarCount;
+    boxcarSum = 0;
+    boxcarCount = 0;
+
+    if (!emaStarted)
+    {
+        value = decimated;
+        emaStarted = true;
+    }
+    else
+    {
+        value += emaAlpha * (decimated - value);
+    }
+    return true;
+}
+
+/**
+ * @brief                   Get the last output sample of the filter
+ *
+ * @returns                 Filtered reading in raw ADC codes, with a fractional part
+ *
+ */
+float GasSampleFilter::getValue()
+{
+    return value;
+}
+
+/**
+ * @brief                   Add a sample to the median window and get the median of it
+ *
+ * @note                    Until the window fills up, the median of the samples so far is used
+ *
+ */
+int16_t GasSampleFilter::median(int16_t _raw)
+{
+    if (medianSize == 1)
+        return _raw;
+
+    medianWindow[medianPos] = _raw;
+    medianPos = (medianPos + 1) % medianSize;
+    if (medianFill < medianSize)
+        medianFill++;
+
+    // Insertion sort of a copy, the window is at most FILTER_MAX_MEDIAN long
+    int16_t sorted[FILTER_MAX_MEDIAN];
+    for (uint8_t i = 0; i < medianFill; i++)
+    {
+        int16_t v = medianWindow[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[medianFill / 2];
+}
@@ -0,0 +1,62 @@
+/**
+ **************************************************
+ *
+ * @file        GasSampleFilter.h
+ * @brief       Header file for the raw sample filter pipeline.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __GAS_SAMPLE_FILTER_SOLDERED__
+#define __GAS_SAMPLE_FILTER_SOLDERED__
+
+#include "Arduino.h"
+
+// Largest median window, must be odd
+#ifndef FILTER_MAX_MEDIAN
+#define FILTER_MAX_MEDIAN 7
+#endif
+
+static_assert(FILTER_MAX_MEDIAN % 2 == 1, "FILTER_MAX_MEDIAN must be odd, setMedian() rounds even sizes up");
+
+// Filters raw ADC readings before they're converted to PPM, in this order:
+//  1. median of the last N samples, to reject single-sample spikes
+//  2. boxcar average of N samples, emitting only one sample per N (decimation)
+//  3. exponential moving average of the decimated samples
+// Every stage is off by default. The output is still in raw ADC codes, but with a fractional
+// part, convert it with ElectrochemicalGasSensor::filteredRawToPPM().
+class GasSampleFilter
+{
+  public:
+    GasSampleFilter();
+    void setMedian(uint8_t _n);
+    void setDecimation(uint16_t _n);
+    void setEMA(float _alpha);
+    void reset();
+    bool push(int16_t _raw);
+    float getValue();
+
+  private:
+    // Median stage
+    int16_t medianWindow[FILTER_MAX_MEDIAN];
+    uint8_t medianSize;
+    uint8_t medianFill;
+    uint8_t medianPos;
+
+    // Boxcar and decimation stage
+    int32_t boxcarSum;
+    uint16_t boxcarSize;
+    uint16_t boxcarCount;
+
+    // EMA stage
+    float emaAlpha;
+    bool emaStarted;
+
+    float value;
+
+    int16_t median(int16_t _raw);
+};
+
+#endif
@@ -0,0 +1,276 @@
+/**
+ * **************************************************
+ *
+ * @file        GasSensorArray.cpp
+ * @brief       Reading many sensors on one I2C bus at once.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#include "GasSensorArray.h"
+
+/**
+ * @brief                   Constructor, the array starts empty
+ *
+ */
+GasSensorArray::GasSensorArray()
+{
+    count = 0;
+    numPending = 0;
+    scanOk = true;
+    for (uint8_t i = 0; i < GAS_SENSOR_ARRAY_MAX_SENSORS; i++)
+    {
+        sensors[i] = nullptr;
+        results[i] = -1;
+        pending[i] = false;
+        queued[i] = false;
+    }
+}
+
+/**
+ * @brief                   Add a sensor to the array
+ *
+ * @note                    The array only keeps a pointer, the sensor object has to outlive it
+ *
+ * @param ElectrochemicalGasSensor &_sensor The sensor to add
+ *
+ * @returns                 True if it was added, false if the array is full
+ *
+ */
+bool GasSensorArray::add(ElectrochemicalGasSensor &_sensor)
+{
+    if (count >= GAS_SENSOR_ARRAY_MAX_SENSORS)
+        return false;
+
+    sensors[count] = &_sensor;
+    results[count] = -1;
+    pending[count] = false;
+    queued[count] = false;
+    count++;
+    return true;
+}
+
+/**
+ * @brief                   Get how many sensors are in the array
+ *
+ * @returns                 The number of sensors added with add()
+ *
+ */
+uint8_t GasSensorArray::size()
+{
+    return count;
+}
+
+/**
+ * @brief                   Call begin() on all the sensors in the array
+ *
+ * @note                    The LMP91000s of legacy boards with a configPin are configured by an
+ *                          LMPConfigManager, so boards with the same config share one write sequence.
+ *                          Bridge boards configure themselves in the meantime, all of them at once.
+ *
+ * @returns                 True if all of them were initialized successfully
+ *
+ */
+bool GasSensorArray::begin()
+{
+    LMPConfigManager manager;
+    bool managed[GAS_SENSOR_ARRAY_MAX_SENSORS];
+    bool result = true;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        managed[i] = manager.add(*sensors[i]);
+        result &= sensors[i]->begin(false);
+    }
+
+    // Send the config to every board the manager doesn't take, bridge boards then work on it in the background
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!managed[i])
+            sensors[i]->requestConfigure();
+    }
+
+    manager.begin();
+    result &= manager.configure();
+
+    // Collect the bridge boards in the order they finish
+    bool waiting = true;
+    while (waiting)
+    {
+        waiting = false;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (!managed[i] && !sensors[i]->isConfigureDone())
+                waiting = true;
+        }
+        yield();
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!managed[i])
+            result &= sensors[i]->isConfigured();
+    }
+    return result;
+}
+
+/**
+ * @brief                   Measure all the sensors in the array
+ *
+ * @note                    This is a blocking function, it waits for the slowest sensor in the array,
+ *                          or for the timeout of a sensor which doesn't answer
+ *
+ * @returns                 True if all the measurements were successful
+ *
+ */
+bool GasSensorArray::scan()
+{
+    startScan();
+    while (!pollScan())
+        yield();
+    return scanOk;
+}
+
+/**
+ * @brief                   Start a conversion on every sensor in the array without waiting for them
+ *
+ * @note                    Call pollScan() until it returns true, then read the results with getPPM().
+ *                          Cells which share an ADS1115 with one added before them are queued, pollScan()
+ *                          starts them when the ADS1115 is free.
+ *
+ * @returns                 True if all the conversions were started
+ *
+ */
+bool GasSensorArray::startScan()
+{
+    numPending = 0;
+    scanOk = true;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        results[i] = -1;
+        pending[i] = false;
+        queued[i] = false;
+
+        ElectrochemicalGasSensor *host = sensors[i]->adcHost();
+        for (uint8_t j = 0; j < i && !queued[i]; j++)
+            queued[i] = (pending[j] || queued[j]) && sensors[j]->adcHost() == host;
+
+        if (!queued[i])
+            pending[i] = sensors[i]->requestMeasurement();
+        if (pending[i] || queued[i])
+            numPending++;
+        else
+            scanOk = false;
+    }
+
+    return scanOk;
+}
+
+// Start the first queued cell on an ADS1115 which just became free
+void GasSensorArray::startNext(ElectrochemicalGasSensor *_host)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!queued[i] || sensors[i]->adcHost() != _host)
+            continue;
+
+        queued[i] = false;
+        pending[i] = sensors[i]->requestMeasurement();
+        if (pending[i])
+            return;
+
+        // Couldn't start, on to the next one
+        scanOk = false;
+        numPending--;
+    }
+}
+
+/**
+ * @brief                   Collect the results of the sensors which have finished converting
+ *
+ * @note                    Checks every pending sensor once and never waits, so sensors are
+ *                          read in the order they finish. A sensor isn't read over I2C before its
+ *                          conversion can be done, and one which doesn't answer counts as failed
+ *                          once its timeout passes
+ *
+ * @returns                 True if all the results were collected
+ *
+ */
+bool GasSensorArray::pollScan()
+{
+    for (uint8_t i = 0; i < count && numPending != 0; i++)
+    {
+        if (!pending[i] || !sensors[i]->isMeasurementReady())
+            continue;
+
+        results[i] = sensors[i]->readPPM();
+        if (results[i] < 0)
+            scanOk = false;
+
+        pending[i] = false;
+        numPending--;
+        startNext(sensors[i]->adcHost());
+    }
+
+    return numPending == 0;
+}
+
+/**
+ * @brief                   Check if the scan started with startScan() is done
+ *
+ * @returns                 True if all the results were collected
+ *
+ */
+bool GasSensorArray::isScanDone()
+{
+    return numPending == 0;
+}
+
+/**
+ * @brief                   Get the PPM value of a sensor from the last scan
+ *
+ * @param uint8_t _index    Index of the sensor, in the order they were added
+ *
+ * @returns                 double value of the PPM, -1 if the index is invalid or the measurement failed
+ *
+ */
+double GasSensorArray::getPPM(uint8_t _index)
+{
+    if (_index >= count)
+        return -1;
+    return results[_index];
+}
+
+/**
+ * @brief                   Get the PPB value of a sensor from the last scan
+ *
+ * @param uint8_t _index    Index of the sensor, in the order they were added
+ *
+ * @returns                 double value of the PPB, -1 if the index is invalid or the measurement failed
+ *
+ */
+double GasSensorArray::getPPB(uint8_t _index)
+{
+    double ppm = getPPM(_index);
+    if (ppm < 0)
+        return -1;
+    return ppm * 1000.0;
+}
+
+/**
+ * @brief                   Get a sensor from the array
+ *
+ * @param uint8_t _index    Index of the sensor, in the order they were added
+ *
+ * @returns                 Pointer to the sensor, nullptr if the index is invalid
+ *
+ */
+ElectrochemicalGasSensor *GasSensorArray::getSensor(uint8_t _index)
+{
+    if (_index >= count)
+        return nullptr;
+    return sensors[_index];
+}
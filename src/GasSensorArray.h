@@ -0,0 +1,54 @@
+/**
+ **************************************************
+ *
+ * @file        GasSensorArray.h
+ * @brief       Header file for reading many sensors on one I2C bus at once.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __GAS_SENSOR_ARRAY_SOLDERED__
+#define __GAS_SENSOR_ARRAY_SOLDERED__
+
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+#include "LMPConfigManager.h"
+
+// How many sensors one GasSensorArray can hold, the storage is fixed so there's no heap use
+#ifndef GAS_SENSOR_ARRAY_MAX_SENSORS
+#define GAS_SENSOR_ARRAY_MAX_SENSORS 8
+#endif
+
+// Starts the conversions on all sensors in one pass and then collects the results in the
+// order they finish, so a full scan takes about one conversion time instead of one per sensor.
+// Legacy direct-wired and ATtiny bridge boards can be mixed in the same array.
+// Cells of a multi-cell board which share one ADS1115 take turns on it in the order they were added,
+// while the other ADS1115s keep converting, so a scan takes one conversion time per cell on the busiest one.
+class GasSensorArray
+{
+  public:
+    GasSensorArray();
+    bool add(ElectrochemicalGasSensor &_sensor);
+    uint8_t size();
+    bool begin();
+    bool scan();
+    bool startScan();
+    bool pollScan();
+    bool isScanDone();
+    double getPPM(uint8_t _index);
+    double getPPB(uint8_t _index);
+    ElectrochemicalGasSensor *getSensor(uint8_t _index);
+
+  private:
+    ElectrochemicalGasSensor *sensors[GAS_SENSOR_ARRAY_MAX_SENSORS];
+    double results[GAS_SENSOR_ARRAY_MAX_SENSORS];
+    bool pending[GAS_SENSOR_ARRAY_MAX_SENSORS];
+    bool queued[GAS_SENSOR_ARRAY_MAX_SENSORS]; // waiting for another cell to finish on the same ADS1115
+    uint8_t count;
+    uint8_t numPending;
+    bool scanOk;
+    void startNext(ElectrochemicalGasSensor *_host);
+};
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ **************************************************
+ *
+ * @file        LMPConfigManager.cpp
+ * @brief       Configuring the LMP91000s of many legacy boards at once.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#include "LMPConfigManager.h"
+
+/**
+ * @brief                   Constructor, the manager starts without boards
+ *
+ */
+LMPConfigManager::LMPConfigManager()
+{
+    count = 0;
+    groupCount = 0;
+    for (uint8_t i = 0; i < LMP_CONFIG_MAX_BOARDS; i++)
+        sensors[i] = nullptr;
+}
+
+/**
+ * @brief                   Add a board whose LMP91000 the manager will configure
+ *
+ * @note                    The manager only keeps a pointer, the sensor object has to outlive it
+ *
+ * @param ElectrochemicalGasSensor &_sensor The sensor to add, a legacy board with a configPin
+ *
+ * @returns                 True if it was added, false if the manager is full, the board is a bridge
+ *                          board, its LMPEN is tied to GND or it's on another I2C bus than the others
+ *
+ */
+bool LMPConfigManager::add(ElectrochemicalGasSensor &_sensor)
+{
+    if (count >= LMP_CONFIG_MAX_BOARDS)
+        return false;
+
+    // Bridge boards configure their own LMP91000 and a board with LMPEN on GND can't be deselected
+    bool bridge = _sensor.adcAddr >= BRIDGE_ADDR_MIN && _sensor.adcAddr <= BRIDGE_ADDR_MAX;
+    if (bridge || _sensor.configPin == -1)
+        return false;
+
+    if (count != 0 && _sensor.wire != sensors[0]->wire)
+        return false;
+
+    sensors[count] = &_sensor;
+    count++;
+    return true;
+}
+
+/**
+ * @brief                   Get how many boards were added
+ *
+ * @returns                 The number of boards added with add()
+ *
+ */
+uint8_t LMPConfigManager::size()
+{
+    return count;
+}
+
+/**
+ * @brief                   Take over the MENB pins, all the LMP91000s are deselected afterwards
+ *
+ */
+void LMPConfigManager::begin()
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        pinMode(sensors[i]->configPin, OUTPUT);
+        digitalWrite(sensors[i]->configPin, HIGH);
+    }
+}
+
+/**
+ * @brief                   Configure the LMP91000s of all the boards, one write sequence per distinct config
+ *
+ * @note                    The sensors have to be started with begin(false) or begin() before
+ *
+ * @returns                 True if all the boards were configured successfully
+ *
+ */
+bool LMPConfigManager::configure()
+{
+    if (count == 0)
+        return true;
+
+    // All the boards are on one bus, the broadcasts go through a driver of their own
+    LMP91000 broadcast(sensors[0]->wire);
+
+    uint8_t done = 0; // bit i is set when board i has been configured in a group
+    bool result = true;
+    groupCount = 0;
+
+    // Boards whose driver already wrote the config are done, they aren't written again with a group.
+    // Boards with warm start enabled are read back one by one first, the ones which kept their config are done
+    for (uint8_t i = 0; i < count; i++)
+    {
+        ElectrochemicalGasSensor *sensor = sensors[i];
+        sensor->warmStarted = false;
+        if (sensor->lmp == nullptr)
+            continue;
+
+        uint8_t tiacn = sensor->lmpTiacnValue();
+        uint8_t refcn = sensor->lmpRefcnValue();
+        uint8_t modecn = sensor->lmpModecnValue();
+        if (sensor->lmp->isConfiguredAs(tiacn, refcn, modecn))
+        {
+            sensor->loadConfig();
+            done |= 1 << i;
+            continue;
+        }
+        if (!sensor->warmStart || sensor->lmp->isConfigured())
+            continue;
+
+        selectGroup(1 << i, LOW);
+        bool same = sensor->lmp->verifyConfig(tiacn, refcn, modecn);
+        selectGroup(1 << i, HIGH);
+
+        if (same)
+        {
+            sensor->warmStarted = true;
+            sensor->loadConfig();
+            done |= 1 << i;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (done & (1 << i))
+            continue;
+
+        uint8_t tiacn = sensors[i]->lmpTiacnValue();
+        uint8_t refcn = sensors[i]->lmpRefcnValue();
+        uint8_t modecn = sensors[i]->lmpModecnValue();
+
+        // Every other board with the same register values goes in the same group
+        uint8_t group = 0;
+        for (uint8_t j = i; j < count; j++)
+        {
+            if (!(done & (1 << j)) && sensors[j]->lmpTiacnValue() == tiacn && sensors[j]->lmpRefcnValue() == refcn &&
+                sensors[j]->lmpModecnValue() == modecn)
+                group |= 1 << j;
+        }
+
+        // A read with several boards answering at once doesn't tell if each of them took the config,
+        // so only a single board is checked and read back by the driver itself
+        bool single = (group & (group - 1)) == 0;
+        broadcast.setVerify(single);
+        if (single)
+        {
+            // The driver has nothing cached for the board, so the whole config is written to it
+            broadcast.resync();
+        }
+        else
+        {
+            // Mark every register as different from the config, so all of them are written without
+            // the status read of a driver which knows nothing about the device
+            broadcast.assumeConfigured((uint8_t)~tiacn, (uint8_t)~refcn, (uint8_t)~modecn);
+        }
+        selectGroup(group, LOW);
+        bool ok = broadcast.configure(tiacn, refcn, modecn);
+        selectGroup(group, HIGH);
+
+        for (uint8_t j = 0; j < count; j++)
+        {
+            if (!(group & (1 << j)))
+                continue;
+
+            // Read each board of a group back on its own, that also keeps the driver of the sensor in sync
+            // so its configureLMP() doesn't write it all again
+            ElectrochemicalGasSensor *sensor = sensors[j];
+            if (sensor->lmp != nullptr && !single)
+            {
+                selectGroup(1 << j, LOW);
+                result &= sensor->lmp->verifyConfig(tiacn, refcn, modecn);
+                selectGroup(1 << j, HIGH);
+            }
+            else if (ok && sensor->lmp != nullptr)
+            {
+                sensor->lmp->assumeConfigured(tiacn, refcn, modecn);
+            }
+            else if (sensor->lmp != nullptr)
+            {
+                sensor->lmp->resync();
+            }
+            sensor->loadConfig();
+        }
+
+        done |= group;
+        groupCount++;
+        result &= ok;
+    }
+
+    return result;
+}
+
+/**
+ * @brief                   Get how many write sequences the last configure() needed
+ *
+ * @returns                 The number of distinct configs among the boards which had to be written
+ *
+ */
+uint8_t LMPConfigManager::getGroupCount()
+{
+    return groupCount;
+}
+
+/**
+ * @brief                   Drive the MENB pins of a group of boards
+ *
+ * @param uint8_t _mask     Bit i selects board i
+ *
+ * @param uint8_t _level    LOW to let the group listen, HIGH to deselect it
+ *
+ */
+void LMPConfigManager::selectGroup(uint8_t _mask, uint8_t _level)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (_mask & (1 << i))
+            digitalWrite(sensors[i]->configPin, _level);
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ **************************************************
+ *
+ * @file        LMPConfigManager.h
+ * @brief       Header file for configuring the LMP91000s of many legacy boards at once.
+ *
+ *
+ * @copyright GNU General Public License v3.0
+ * @authors     @ soldered.com
+ ***************************************************/
+
+#ifndef __LMP_CONFIG_MANAGER_SOLDERED__
+#define __LMP_CONFIG_MANAGER_SOLDERED__
+
+#include "Electrochemical-Gas-Sensor-SOLDERED.h"
+
+// How many boards one LMPConfigManager can hold, the storage is fixed so there's no heap use
+#ifndef LMP_CONFIG_MAX_BOARDS
+#define LMP_CONFIG_MAX_BOARDS 8
+#endif
+#if LMP_CONFIG_MAX_BOARDS > 8
+#error "LMP_CONFIG_MAX_BOARDS can be at most 8, the groups are kept as 8-bit masks"
+#endif
+
+// All LMP91000s answer at LMP91000_I2C_ADDRESS and only listen while their MENB (LMPEN) pin is LOW.
+// The manager owns the MENB pins of its boards, groups the boards with identical TIACN/REFCN/MODECN
+// and configures each group with one write sequence while all of its MENB pins are LOW together.
+// Nothing is read while more than one board listens, the group is written without the read-backs
+// and then each board is read back on its own with only its MENB pin LOW.
+// Boards whose cached registers already hold their config are left out of the group writes, and
+// boards with setWarmStart() enabled are read back first and left alone if they kept their config.
+// Only legacy boards with a configPin can be added, all of them have to be on the same I2C bus.
+class LMPConfigManager
+{
+  public:
+    LMPConfigManager();
+    bool add(ElectrochemicalGasSensor &_sensor);
+    uint8_t size();
+    void begin();
+    bool configure();
+    uint8_t getGroupCount();
+
+  private:
+    ElectrochemicalGasSensor *sensors[LMP_CONFIG_MAX_BOARDS];
+    uint8_t count;
+    uint8_t groupCount;
+    void selectGroup(uint8_t _mask, uint8_t _level);
+};
+
+#endif
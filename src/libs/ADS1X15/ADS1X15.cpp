@@ -37,6 +37,12 @@
 #define ADS1X15_REG_LOW_THRESHOLD   0x02
 #define ADS1X15_REG_HIGH_THRESHOLD  0x03
 
+// SHADOW REGISTERS
+#define ADS1X15_SHADOW_CONFIG       0x01
+#define ADS1X15_SHADOW_LOW          0x02
+#define ADS1X15_SHADOW_HIGH         0x04
+#define ADS1X15_POINTER_UNKNOWN     0xFF
+
 
 // CONFIG REGISTER
 
@@ -134,6 +140,7 @@ differs for different devices, check datasheet or readme.md
 ADS1X15::ADS1X15()
 {
   reset();
+  resync();
 }
 
 
@@ -149,7 +156,7 @@ void ADS1X15::reset()
 
   // COMPARATOR variables   # see notes .h 
   _compMode       = 0;
-  _compPol        = 1;
+  _compPol        = 0;    // ALERT/RDY active low, as in the datasheet
   _compLatch      = 0;
   _compQueConvert = 3;
 }
@@ -160,6 +167,7 @@ bool ADS1X15::begin(uint8_t sda, uint8_t scl)
 {
   _wire = &Wire;
   _wire->begin(sda, scl);
+  resync();
   if ((_address < 0x48) || (_address > 0x4B)) return false;
   if (! isConnected()) return false;
   return true;
@@ -170,12 +178,20 @@ bool ADS1X15::begin(uint8_t sda, uint8_t scl)
 bool ADS1X15::begin()
 {
   _wire->begin();
+  resync();
   if ((_address < 0x48) || (_address > 0x4B)) return false;
   if (! isConnected()) return false;
   return true;
 }
 
 
+void ADS1X15::resync()
+{
+  _shadowValid = 0;
+  _pointer = ADS1X15_POINTER_UNKNOWN;
+}
+
+
 bool ADS1X15::isBusy()
 {
   uint16_t val = _readRegister(_address, ADS1X15_REG_CONFIG);
@@ -187,7 +203,9 @@ bool ADS1X15::isBusy()
 bool ADS1X15::isConnected()
 {
   _wire->beginTransmission(_address);
-  return (_wire->endTransmission() == 0);
+  bool ok = (_wire->endTransmission() == 0);
+  I2C_COUNT_WRITE(_counters, 0, ok);
+  return ok;
 }
 
 
@@ -335,7 +353,12 @@ int16_t ADS1X15::getValue()
 
 void ADS1X15::setComparatorThresholdLow(int16_t lo)
 {
-  _writeRegister(_address, ADS1X15_REG_LOW_THRESHOLD, lo);
+  if ((_shadowValid & ADS1X15_SHADOW_LOW) && (lo == _lowShadow)) return;
+  if (_writeRegister(_address, ADS1X15_REG_LOW_THRESHOLD, lo))
+  {
+    _lowShadow = lo;
+    _shadowValid |= ADS1X15_SHADOW_LOW;
+  }
 };
 
 
@@ -347,7 +370,12 @@ int16_t ADS1X15::getComparatorThresholdLow()
 
 void ADS1X15::setComparatorThresholdHigh(int16_t hi)
 {
-  _writeRegister(_address, ADS1X15_REG_HIGH_THRESHOLD, hi);
+  if ((_shadowValid & ADS1X15_SHADOW_HIGH) && (hi == _highShadow)) return;
+  if (_writeRegister(_address, ADS1X15_REG_HIGH_THRESHOLD, hi))
+  {
+    _highShadow = hi;
+    _shadowValid |= ADS1X15_SHADOW_HIGH;
+  }
 };
 
 
@@ -456,9 +484,7 @@ int16_t ADS1X15::_readADC(uint16_t readmode)
 
 void ADS1X15::_requestADC(uint16_t readmode)
 {
-  // write to register is needed in continuous mode as other flags can be changed
-  uint16_t config = ADS1X15_OS_START_SINGLE;  // bit 15     force wake up if needed
-  config |= readmode;                         // bit 12-14
+  uint16_t config = readmode;                 // bit 12-14
   config |= _gain;                            // bit 9-11
   config |= _mode;                            // bit 8
   config |= _datarate;                        // bit 5-7
@@ -469,7 +495,16 @@ void ADS1X15::_requestADC(uint16_t readmode)
   if (_compLatch) config |= ADS1X15_COMP_LATCH;
   else            config |= ADS1X15_COMP_NON_LATCH;           // bit 2      ALERT latching
   config |= _compQueConvert;                                  // bit 0..1   ALERT mode
-  _writeRegister(_address, ADS1X15_REG_CONFIG, config);
+
+  // continuous mode keeps converting with the config it has, only write it when a flag changed
+  if ((_mode == ADS1X15_MODE_CONTINUE) && (_shadowValid & ADS1X15_SHADOW_CONFIG) && (config == _configShadow)) return;
+
+  // single shot needs the OS bit written for every conversion, the rest of the config comes along
+  if (_writeRegister(_address, ADS1X15_REG_CONFIG, config | ADS1X15_OS_START_SINGLE))  // bit 15  force wake up if needed
+  {
+    _configShadow = config;
+    _shadowValid |= ADS1X15_SHADOW_CONFIG;
+  }
 }
 
 bool ADS1X15::_writeRegister(uint8_t address, uint8_t reg, uint16_t value)
@@ -478,22 +513,35 @@ bool ADS1X15::_writeRegister(uint8_t address, uint8_t reg, uint16_t value)
   _wire->write((uint8_t)reg);
   _wire->write((uint8_t)(value >> 8));
   _wire->write((uint8_t)(value & 0xFF));
-  return (_wire->endTransmission() == 0);
+  bool ok = (_wire->endTransmission() == 0);
+  I2C_COUNT_WRITE(_counters, 3, ok);
+  if (ok) _pointer = reg;
+  else    resync();
+  return ok;
 }
 
 uint16_t ADS1X15::_readRegister(uint8_t address, uint8_t reg)
 {
-  _wire->beginTransmission(address);
-  _wire->write(reg);
-  _wire->endTransmission();
+  // the pointer stays where it was, only move it to read another register
+  if (_pointer != reg)
+  {
+    _wire->beginTransmission(address);
+    _wire->write(reg);
+    bool ok = (_wire->endTransmission() == 0);
+    I2C_COUNT_WRITE(_counters, 1, ok);
+    if (ok) _pointer = reg;
+    else    resync();
+  }
 
   int rv = _wire->requestFrom(address, (uint8_t) 2);
+  I2C_COUNT_READ(_counters, 2, rv);
   if (rv == 2) 
   {
     uint16_t value = _wire->read() << 8;
     value += _wire->read();
     return value;
   }
+  resync();
   return 0x0000;
 }
 
@@ -10,6 +10,7 @@
 
 #include "Arduino.h"
 #include "Wire.h"
+#include "../../ElectrochemicalSensorStats.h"
 
 #define ADS1X15_LIB_VERSION               (F("0.3.1"))
 
@@ -83,6 +84,15 @@ public:
   bool     isReady() { return isBusy() == false; };
 
 
+  // SHADOW REGISTERS
+  // The last values written to the device are cached: an unchanged configuration is not sent
+  // again in continuous mode, a single-shot trigger is the cached config + the OS bit, and
+  // repeated reads of the same register skip the register pointer write.
+  // Call resync() after a bus error or if something else may have changed the device,
+  // the next access then writes everything again. Bus errors seen by the driver do this themselves.
+  void     resync();
+
+
   // COMPARATOR
   // 0    = TRADITIONAL   > high          => on      < low   => off
   // else = WINDOW        > high or < low => on      between => off
@@ -91,12 +101,12 @@ public:
 
   // 0    = LOW (default)
   // else = HIGH
-  void     setComparatorPolarity(uint8_t pol) { _compPol = pol ? 0 : 1; };
+  void     setComparatorPolarity(uint8_t pol) { _compPol = pol ? 1 : 0; };
   uint8_t  getComparatorPolarity()            { return _compPol; };
 
   // 0    = NON LATCH
   // else = LATCH
-  void     setComparatorLatch(uint8_t latch) { _compLatch = latch ? 0 : 1; };
+  void     setComparatorLatch(uint8_t latch) { _compLatch = latch ? 1 : 0; };
   uint8_t  getComparatorLatch()              { return _compLatch; };
 
   // 0   = trigger alert after 1 conversion
@@ -118,6 +128,11 @@ public:
   // proto - getWireClock returns the value set by setWireClock not necessary the actual value
   uint32_t getWireClock();
 
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+  // count the I2C traffic of this device into counters, nullptr to stop counting
+  void     setCounters(I2CCounters *counters) { _counters = counters; };
+#endif
+
 protected:
   ADS1X15();
 
@@ -156,8 +171,18 @@ protected:
   uint16_t _readRegister(uint8_t address, uint8_t reg);
   int8_t   _err = ADS1X15_OK;
 
+  // shadow registers, see resync()
+  uint16_t _configShadow = 0;       // without the OS bit
+  int16_t  _lowShadow    = 0;
+  int16_t  _highShadow   = 0;
+  uint8_t  _shadowValid  = 0;       // ADS1X15_SHADOW_* flags
+  uint8_t  _pointer;                // register the pointer is set to, ADS1X15_POINTER_UNKNOWN if not known
+
   TwoWire*  _wire;
   uint32_t  _clockSpeed = 0;
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+  I2CCounters *_counters = nullptr;
+#endif
 };
 
 ///////////////////////////////////////////////////////////////////////////
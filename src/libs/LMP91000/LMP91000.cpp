@@ -1,15 +1,26 @@
 #include "LMP91000.h"
 
-LMP91000::LMP91000() {
-
+LMP91000::LMP91000(TwoWire *wire, uint8_t address) {
+      _wire = wire;
+      _address = address;
+      _verify = true;
+      _shadowValid = 0;
+      _tiacnShadow = 0;
+      _refcnShadow = 0;
+      _modecnShadow = 0;
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+      _counters = nullptr;
+#endif
 }
 
 uint8_t LMP91000::write(uint8_t reg, uint8_t data) {
 
-      Wire.beginTransmission(LMP91000_I2C_ADDRESS);           // START+SLA+W
-      Wire.write(reg);                                        // REG
-      Wire.write(data);                                       // DATA
-      Wire.endTransmission(true); // generate stop condition  // STOP
+      _wire->beginTransmission(_address);                     // START+SLA+W
+      _wire->write(reg);                                      // REG
+      _wire->write(data);                                     // DATA
+      uint8_t err = _wire->endTransmission(true); // generate stop condition // STOP
+      I2C_COUNT_WRITE(_counters, 2, err == 0);
+      (void)err;
 
       // read back the value of the register
       return read(reg);
@@ -17,17 +28,32 @@ uint8_t LMP91000::write(uint8_t reg, uint8_t data) {
 
 uint8_t LMP91000::read(uint8_t reg){
       uint8_t chr = 0;
-      Wire.beginTransmission(LMP91000_I2C_ADDRESS);           // START+SLA+W
-      Wire.write(reg);                                        // REG
-      Wire.endTransmission(false);                            // REP START
-      Wire.requestFrom(LMP91000_I2C_ADDRESS, 1, true);        // SLA+R
-      if(Wire.available()){
-            chr = Wire.read();                                // DATA
-      }
-      
+      readRegister(reg, chr);
       return chr;
 }
 
+// read() which tells if the device answered
+bool LMP91000::readRegister(uint8_t reg, uint8_t &data){
+      _wire->beginTransmission(_address);                     // START+SLA+W
+      _wire->write(reg);                                      // REG
+      uint8_t err = _wire->endTransmission(false);            // REP START
+      I2C_COUNT_WRITE(_counters, 1, err == 0);
+      uint8_t received = _wire->requestFrom(_address, (uint8_t)1, (uint8_t)true); // SLA+R
+      I2C_COUNT_READ(_counters, 1, received);
+      if(err != 0 || received < 1 || !_wire->available()){
+            return false;
+      }
+      data = _wire->read();                                   // DATA
+      return true;
+}
+
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+// count the I2C traffic of this device into counters, nullptr to stop counting
+void LMP91000::setCounters(I2CCounters *counters) {
+      _counters = counters;
+}
+#endif
+
 uint8_t LMP91000::status(void) {
       return read(LMP91000_STATUS_REG);
 }      
@@ -41,14 +67,92 @@ uint8_t LMP91000::unlock(){
 }
 
 uint8_t LMP91000::configure(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn){
-      if(status() == LMP91000_READY){
-            unlock();
-            write(LMP91000_TIACN_REG, _tiacn);
-            write(LMP91000_REFCN_REG, _refcn);
-            write(LMP91000_MODECN_REG, _modecn);
-            lock();
+      bool tiacnChanged = !(_shadowValid & LMP91000_SHADOW_TIACN) || _tiacn != _tiacnShadow;
+      bool refcnChanged = !(_shadowValid & LMP91000_SHADOW_REFCN) || _refcn != _refcnShadow;
+      bool modecnChanged = !(_shadowValid & LMP91000_SHADOW_MODECN) || _modecn != _modecnShadow;
+
+      // Already configured like this, nothing to send
+      if(!tiacnChanged && !refcnChanged && !modecnChanged){
             return 1;
       }
-      return 0;
+
+      // Only check the status when nothing is known about the device yet, a NACK tells us later on
+      if(_shadowValid == 0 && status() != LMP91000_READY){
+            return 0;
+      }
+
+      bool ok = true;
+
+      // The lock only protects TIACN and REFCN, MODECN can be written any time
+      if(tiacnChanged || refcnChanged){
+            ok = writeRegister(LMP91000_LOCK_REG, LMP91000_WRITE_UNLOCK);
+            if(ok && tiacnChanged){
+                  ok = writeRegister(LMP91000_TIACN_REG, _tiacn);
+                  _tiacnShadow = _tiacn;
+            }
+            if(ok && refcnChanged){
+                  ok = writeRegister(LMP91000_REFCN_REG, _refcn);
+                  _refcnShadow = _refcn;
+            }
+            ok = writeRegister(LMP91000_LOCK_REG, LMP91000_WRITE_LOCK) && ok;
+      }
+      if(ok && modecnChanged){
+            ok = writeRegister(LMP91000_MODECN_REG, _modecn);
+            _modecnShadow = _modecn;
+      }
+
+      // On any error the device state is unknown, write everything next time
+      _shadowValid = ok ? LMP91000_SHADOW_ALL : 0;
+      return ok ? 1 : 0;
+}
+
+bool LMP91000::isConfigured(){
+      return _shadowValid == LMP91000_SHADOW_ALL;
+}
+
+bool LMP91000::isConfiguredAs(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn){
+      return isConfigured() && _tiacnShadow == _tiacn && _refcnShadow == _refcn && _modecnShadow == _modecn;
+}
+
+void LMP91000::resync(){
+      _shadowValid = 0;
+}
+
+void LMP91000::assumeConfigured(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn){
+      _tiacnShadow = _tiacn;
+      _refcnShadow = _refcn;
+      _modecnShadow = _modecn;
+      _shadowValid = LMP91000_SHADOW_ALL;
+}
+
+bool LMP91000::verifyConfig(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn){
+      uint8_t tiacn, refcn, modecn;
+      if(!readRegister(LMP91000_TIACN_REG, tiacn) || !readRegister(LMP91000_REFCN_REG, refcn) ||
+         !readRegister(LMP91000_MODECN_REG, modecn)){
+            _shadowValid = 0;
+            return false;
+      }
+
+      // Even if it doesn't match, configure() now only has to write the registers which differ
+      assumeConfigured(tiacn, refcn, modecn);
+      return tiacn == _tiacn && refcn == _refcn && modecn == _modecn;
+}
+
+void LMP91000::setVerify(bool verify){
+      _verify = verify;
+}
+
+// write without the read-back of write(), unless verification is on
+bool LMP91000::writeRegister(uint8_t reg, uint8_t data){
+      _wire->beginTransmission(_address);
+      _wire->write(reg);
+      _wire->write(data);
+      bool ok = _wire->endTransmission(true) == 0;
+      I2C_COUNT_WRITE(_counters, 2, ok);
+
+      if(ok && _verify){
+            ok = read(reg) == data;
+      }
+      return ok;
 }
 
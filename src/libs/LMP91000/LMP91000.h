@@ -10,6 +10,7 @@
 #endif
 
 #include <Wire.h>
+#include "../../ElectrochemicalSensorStats.h"
 
 #define LMP91000_I2C_ADDRESS (0x48) /* Device Address */
 #define LMP91000_STATUS_REG  (0x00) /* Read only status register */
@@ -77,12 +78,18 @@
 
 #define LMP91000_NOT_PRESENT (0xA8) // arbitrary library status code
 
+// Shadow register flags, set when the cached value is known to be in the device
+#define LMP91000_SHADOW_TIACN  (0x01)
+#define LMP91000_SHADOW_REFCN  (0x02)
+#define LMP91000_SHADOW_MODECN (0x04)
+#define LMP91000_SHADOW_ALL    (0x07)
+
 
 class LMP91000
 {
 
   public:
-    LMP91000();
+    LMP91000(TwoWire *wire = &Wire, uint8_t address = LMP91000_I2C_ADDRESS);
     uint8_t status(void);
     uint8_t lock();
     uint8_t unlock();
@@ -90,7 +97,36 @@ class LMP91000
     uint8_t write(uint8_t reg, uint8_t data);
     uint8_t read(uint8_t reg);
 
+    // configure() remembers what it wrote and only writes the registers which changed,
+    // isConfigured() tells if a configuration is cached without any I2C traffic.
+    // Call resync() after writing TIACN/REFCN/MODECN with write() or when the device lost power
+    bool isConfigured();
+    // True if the cached configuration is this one, also without any I2C traffic
+    bool isConfiguredAs(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn);
+    void resync();
+    // Mark the registers as configured by someone else, e.g. a broadcast write to several boards
+    void assumeConfigured(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn);
+    // Read TIACN/REFCN/MODECN back into the cache, true if they already hold this config
+    bool verifyConfig(uint8_t _tiacn, uint8_t _refcn, uint8_t _modecn);
+    // Read each register back after configure() writes it and fail if it doesn't match, on by default
+    void setVerify(bool verify);
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    void setCounters(I2CCounters *counters);
+#endif
+
   private:
+    TwoWire *_wire;
+    uint8_t _address;
+    bool _verify;
+    uint8_t _shadowValid; // LMP91000_SHADOW_* flags
+    uint8_t _tiacnShadow;
+    uint8_t _refcnShadow;
+    uint8_t _modecnShadow;
+    bool writeRegister(uint8_t reg, uint8_t data);
+    bool readRegister(uint8_t reg, uint8_t &data);
+#ifdef ELECTROCHEMICAL_SENSOR_STATS
+    I2CCounters *_counters;
+#endif
 };
 
 #endif
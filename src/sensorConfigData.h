@@ -94,12 +94,79 @@ struct sensorType
     uint8_t OP_MODE;
 };
 
+// Temperature dependence of a cell, relative to the conditions it was calibrated at
+// The points are evenly spaced, firstC, firstC + stepC, ..., linearly interpolated and held beyond the ends
+// The library doesn't ship any curves, they differ between cell makers and batches, so take the values
+// from the datasheet of your cell, see examples/temperatureCompensation
+struct temperatureCurve
+{
+    int8_t firstC;
+    uint8_t stepC;
+    uint8_t points;
+    const float *sensitivity; // output / output at calibration, 1.0 = unchanged
+    const float *zeroPpm;     // what the cell reads in clean air, nullptr if it doesn't drift
+};
+
+// Compile-time helpers to turn a sensorType into LMP91000 register values and gains
+// Used by ElectrochemicalGasSensor at runtime and by ElectrochemicalGasSensorT at compile time
+
+// tiacn register
+constexpr uint8_t lmpTiacn(const sensorType &t)
+{
+    return (uint8_t)((t.TIA_GAIN_IN_KOHMS << 2) | t.RLOAD);
+}
+
+// refcn register
+constexpr uint8_t lmpRefcn(const sensorType &t)
+{
+    return (uint8_t)((t.REF_SOURCE << 7) | (t.INTERNAL_ZERO << 5) | (t.BIAS_SIGN << 4) | t.BIAS);
+}
+
+// modecn register
+constexpr uint8_t lmpModecn(const sensorType &t)
+{
+    return (uint8_t)((t.FET_SHORT << 7) | t.OP_MODE);
+}
+
+// TIA gain in Ohms, -1 for TIA_GAIN_EXTERNAL (use setCustomTiaGain) or invalid values
+constexpr float tiaGainFromCode(uint8_t code)
+{
+    return code == TIA_GAIN_2_75_KOHM  ? 2750.00F
+           : code == TIA_GAIN_3_5_KOHM ? 3500.00F
+           : code == TIA_GAIN_7_KOHM   ? 7000.00F
+           : code == TIA_GAIN_14_KOHM  ? 14000.00F
+           : code == TIA_GAIN_35_KOHM  ? 35000.00F
+           : code == TIA_GAIN_120_KOHM ? 120000.00F
+           : code == TIA_GAIN_350_KOHM ? 350000.00F
+                                       : -1;
+}
+
+// Internal zero in % of the reference, -1 if bypassed (not implemented) or invalid
+constexpr float internalZeroPercentFromCode(uint8_t code)
+{
+    return code == INTERNAL_ZERO_20_PERCENT   ? 20.00F
+           : code == INTERNAL_ZERO_50_PERCENT ? 50.00F
+           : code == INTERNAL_ZERO_67_PERCENT ? 67.00F
+                                              : -1;
+}
+
+// Full scale voltage of the ADS for a gain, invalid values are mapped to 6.144V like ADS1X15::setGain()
+constexpr float adsMaxVoltageFromGain(uint8_t gain)
+{
+    return gain == ADS_GAIN_4_096V   ? 4.096F
+           : gain == ADS_GAIN_2_048V ? 2.048F
+           : gain == ADS_GAIN_1_024V ? 1.024F
+           : gain == ADS_GAIN_0_512V ? 0.512F
+           : gain == ADS_GAIN_0_256V ? 0.256F
+                                     : 6.144F;
+}
+
 // NOTE: The reference voltage is always 2.5V
 // The internal zero voltage has an offset in the PPM calculation - internalZeroCalibration
 // This is due to the fact high gains amplify the noise as well so it's best to further calibrate it
 
 // SGX-4CO - Carbon Monoxide sensor
-const sensorType SENSOR_CO = {
+constexpr sensorType SENSOR_CO = {
     70.0F,                    // nanoAmperesPerPPM
     0,                    // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain
@@ -114,7 +181,7 @@ const sensorType SENSOR_CO = {
 };
 
 // SGX-4NO2 - Nitrogen Dioxide sensor
-const sensorType SENSOR_NO2 = {
+constexpr sensorType SENSOR_NO2 = {
     -600.0F,                  // nanoAmperesPerPPM
     0,                   // internalZeroCalibration
     ADS_GAIN_2_048V,          // adsGain
@@ -129,7 +196,7 @@ const sensorType SENSOR_NO2 = {
 };
 
 // SGX-4SO2 - Sulphur Dioxide sensor
-const sensorType SENSOR_SO2 = {
+constexpr sensorType SENSOR_SO2 = {
     400.0F,                   // nanoAmperesPerPPM
     0,                      // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain
@@ -147,7 +214,7 @@ const sensorType SENSOR_SO2 = {
 // O3 is an oxidizing gas with negative polarity output (like NO2)
 // Internal zero at 67% provides headroom for downward output swing
 // 35kOhm TIA covers the full 0-20ppm range without saturation
-const sensorType SENSOR_O3 = {
+constexpr sensorType SENSOR_O3 = {
     -1000.0F,                  // nanoAmperesPerPPM
     -0.0012,                   // internalZeroCalibration
     ADS_GAIN_2_048V,          // adsGain
@@ -162,7 +229,7 @@ const sensorType SENSOR_O3 = {
 };
 
 // SGX-4NO-250 - Nitric Oxide sensor
-const sensorType SENSOR_NO = {
+constexpr sensorType SENSOR_NO = {
     400.0F,                  // nanoAmperesPerPPM
     0,                      // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain
@@ -177,7 +244,7 @@ const sensorType SENSOR_NO = {
 };
 
 // SGX-4H2S-100 - Hydrogen Sulphide sensor
-const sensorType SENSOR_H2S = {
+constexpr sensorType SENSOR_H2S = {
     1200.0F,                  // nanoAmperesPerPPM
     0,                      // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain
@@ -192,7 +259,7 @@ const sensorType SENSOR_H2S = {
 };
 
 // SGX-4NH3-300 - Ammonia sensor
-const sensorType SENSOR_NH3 = {
+constexpr sensorType SENSOR_NH3 = {
     40.0F,                  // nanoAmperesPerPPM
     0,                      // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain
@@ -207,7 +274,7 @@ const sensorType SENSOR_NH3 = {
 };
 
 // SGX-4CL2 - Chlorine sensor
-const sensorType SENSOR_CL2 = {
+constexpr sensorType SENSOR_CL2 = {
     600.0F,                  // nanoAmperesPerPPM
     0,                      // internalZeroCalibration
     ADS_GAIN_4_096V,          // adsGain